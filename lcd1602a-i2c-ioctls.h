@@ -12,7 +12,141 @@
 #define LCD_MAGIC_IOCTL                0x4C /* ASCII 'L' */
 #define LCD_CURSOR_GET_SEQ             0x01
 #define LCD_CURSOR_SET_SEQ             0x02
+#define LCD_FRAME_BEGIN_SEQ            0x03
+#define LCD_FRAME_SET_SEQ              0x04
+#define LCD_FRAME_COMMIT_SEQ           0x05
+#define LCD_BATCH_SEQ                  0x06
+#define LCD_SCREENSHOT_SEQ             0x07
+#define LCD_PRIORITY_GET_SEQ           0x08
+#define LCD_PRIORITY_SET_SEQ           0x09
+#define LCD_OVERLAY_SEQ                0x0A
+#define LCD_REGION_GET_SEQ             0x0B
+#define LCD_REGION_SET_SEQ             0x0C
+#define LCD_VIEWPORT_GET_SEQ           0x0D
+#define LCD_VIEWPORT_SET_SEQ           0x0E
+#define LCD_WIDGET_SEQ                 0x0F
+#define LCD_CLOCK_SEQ                  0x10
+
+#define LCD_FRAME_ROWS                 2
+#define LCD_FRAME_COLS                 16
+
+/* Visible screen content for LCD_IOC_FRAME_SET and LCD_IOC_SCREENSHOT */
+struct lcd_frame {
+    unsigned char cells[LCD_FRAME_ROWS][LCD_FRAME_COLS];
+};
+
+#define LCD_CGRAM_CHARS                8
+#define LCD_CGRAM_ROWS                 8
+#define LCD_CGRAM_ROW_MASK             0x1f /* 5 pixels per row */
+
+/* Display operations for LCD_IOC_BATCH */
+#define LCD_OP_TEXT                    1 /* put 'len' chars of 'data' at file position 'pos' */
+#define LCD_OP_CURSOR                  2 /* show (value = 1) or hide (value = 0) cursor */
+#define LCD_OP_BACKLIGHT               3 /* enable (value = 1) or disable (value = 0) backlight */
+#define LCD_OP_CGRAM                   4 /* load 8 rows of 'data' as custom char 'pos' (0..7) */
+
+#define LCD_OP_DATA_SIZE               36
+
+struct lcd_op {
+    unsigned char type;
+    unsigned char pos;
+    unsigned char len;
+    unsigned char value;
+    unsigned char data[LCD_OP_DATA_SIZE];
+};
+
+/* Argument of LCD_IOC_BATCH, also used as io_uring command payload (sqe->cmd) */
+struct lcd_batch {
+    unsigned long long ops; /* pointer to array of struct lcd_op */
+    unsigned int nr_ops;    /* up to 32 */
+    unsigned int flags;     /* must be 0 */
+};
+
+/* Argument of LCD_IOC_OVERLAY */
+struct lcd_overlay {
+    unsigned int timeout_ms; /* 0 = remove the current overlay at once */
+    unsigned char pos;       /* file position of the text */
+    unsigned char len;
+    unsigned char reserved[2];
+    unsigned char data[LCD_OP_DATA_SIZE];
+};
+
+/* Rectangle of the screen claimed by a file for LCD_IOC_REGION_SET.
+ * The file then looks like 'rows' rows of 'cols' chars each followed by '\n'. */
+struct lcd_region {
+    unsigned char row;
+    unsigned char col;
+    unsigned char rows;
+    unsigned char cols;
+};
+
+/* Widgets drawn by the driver with its own CGRAM glyphs for LCD_IOC_WIDGET */
+#define LCD_WIDGETS_MAX                8 /* per file */
+#define LCD_WIDGET_NONE                0 /* forget the widget, its cells keep the content */
+#define LCD_WIDGET_HBAR                1 /* 'len' cells wide bar filled from the left */
+#define LCD_WIDGET_VBAR                2 /* 'len' cells high bar filled from the bottom */
+#define LCD_WIDGET_PROGRESS            3 /* horizontal bar followed by percents, e.g. " 42%" */
+#define LCD_WIDGET_BIG_NUMBER          4 /* 'len' digits, 3x2 cells each plus a gap, row must be 0 */
+
+#define LCD_WIDGET_DIGITS_MAX          10
+
+struct lcd_widget {
+    unsigned char id;        /* 0..LCD_WIDGETS_MAX - 1 */
+    unsigned char type;
+    unsigned char row;       /* top left cell inside the file's region */
+    unsigned char col;
+    unsigned char len;       /* LCD_WIDGET_PROGRESS takes 4 cells more for the text */
+    unsigned char reserved[3];
+    unsigned int value;      /* 0..max, bigger values show a full bar */
+    unsigned int max;        /* not used by LCD_WIDGET_BIG_NUMBER */
+};
+
+/* Clock field kept up to date by the driver for LCD_IOC_CLOCK. Format takes
+ * %H %M %S %d %m %y %Y and %%, with LCD_CLOCK_UPTIME %d is days of uptime
+ * and the other date fields are 0. */
+#define LCD_CLOCK_UPTIME               0x01
+#define LCD_CLOCK_FORMAT_SIZE          20
+
+struct lcd_clock {
+    unsigned char row;       /* inside the file's region */
+    unsigned char col;
+    unsigned char flags;
+    unsigned char reserved;
+    char format[LCD_CLOCK_FORMAT_SIZE]; /* "" = remove the clock */
+};
+
 #define LCD_IOC_CURSOR_GET             _IOR(LCD_MAGIC_IOCTL, LCD_CURSOR_GET_SEQ, unsigned int)
 #define LCD_IOC_CURSOR_SET             _IOW(LCD_MAGIC_IOCTL, LCD_CURSOR_SET_SEQ, unsigned int)
+/* Start composing a frame: write() goes to the back buffer until commit */
+#define LCD_IOC_FRAME_BEGIN            _IO(LCD_MAGIC_IOCTL, LCD_FRAME_BEGIN_SEQ)
+/* Replace the whole back buffer and start composing */
+#define LCD_IOC_FRAME_SET              _IOW(LCD_MAGIC_IOCTL, LCD_FRAME_SET_SEQ, struct lcd_frame)
+/* Atomically show the back buffer, only changed cells are sent */
+#define LCD_IOC_FRAME_COMMIT           _IO(LCD_MAGIC_IOCTL, LCD_FRAME_COMMIT_SEQ)
+/* Run display operations under one lock. Also valid as IORING_OP_URING_CMD cmd_op.
+ * Returns number of executed operations. */
+#define LCD_IOC_BATCH                  _IOW(LCD_MAGIC_IOCTL, LCD_BATCH_SEQ, struct lcd_batch)
+/* Get the last committed screen content without waiting for transfers */
+#define LCD_IOC_SCREENSHOT             _IOR(LCD_MAGIC_IOCTL, LCD_SCREENSHOT_SEQ, struct lcd_frame)
+/* Priority of the file's content (default 0). The highest priority content
+ * which has been drawn is shown, the latest update wins among equals. */
+#define LCD_IOC_PRIORITY_GET           _IOR(LCD_MAGIC_IOCTL, LCD_PRIORITY_GET_SEQ, int)
+#define LCD_IOC_PRIORITY_SET           _IOW(LCD_MAGIC_IOCTL, LCD_PRIORITY_SET_SEQ, int)
+/* Show text above everything for timeout_ms, then restore the cells it covered */
+#define LCD_IOC_OVERLAY                _IOW(LCD_MAGIC_IOCTL, LCD_OVERLAY_SEQ, struct lcd_overlay)
+/* Clip and translate file's reads, writes and lseeks into a region (default is
+ * the whole screen). Regions of all files are merged by priority. */
+#define LCD_IOC_REGION_GET             _IOR(LCD_MAGIC_IOCTL, LCD_REGION_GET_SEQ, struct lcd_region)
+#define LCD_IOC_REGION_SET             _IOW(LCD_MAGIC_IOCTL, LCD_REGION_SET_SEQ, struct lcd_region)
+/* First visible column (0..39) when the driver is loaded with viewport=1. Rows
+ * of the file are 40 chars long then and scrolling doesn't resend the text. */
+#define LCD_IOC_VIEWPORT_GET           _IOR(LCD_MAGIC_IOCTL, LCD_VIEWPORT_GET_SEQ, unsigned int)
+#define LCD_IOC_VIEWPORT_SET           _IOW(LCD_MAGIC_IOCTL, LCD_VIEWPORT_SET_SEQ, unsigned int)
+/* Draw a widget's value, the first call for an id places it. CGRAM is taken
+ * by the driver while any widget exists, LCD_OP_CGRAM fails with EBUSY then.
+ * Bars and big numbers need different glyphs and can't be shown together. */
+#define LCD_IOC_WIDGET                 _IOW(LCD_MAGIC_IOCTL, LCD_WIDGET_SEQ, struct lcd_widget)
+/* Show a clock updated every second, one per file. Text past the region is cut. */
+#define LCD_IOC_CLOCK                  _IOW(LCD_MAGIC_IOCTL, LCD_CLOCK_SEQ, struct lcd_clock)
 
 #endif /* LCD1602A_I2C_IOCTLS_H */
@@ -11,8 +11,34 @@
 #include <linux/string.h>
 #include <linux/interrupt.h>
 #include <linux/gpio/consumer.h>
+#include <linux/list.h>
+#include <linux/llist.h>
+#include <linux/spinlock.h>
+#include <linux/workqueue.h>
+#include <linux/wait.h>
+#include <linux/poll.h>
+#include <linux/io_uring/cmd.h>
+#include <linux/input.h>
+#include <linux/timer.h>
+#include <linux/hrtimer.h>
+#include <linux/ktime.h>
+#include <linux/time.h>
+#include <linux/timekeeping.h>
+#include <linux/backlight.h>
+#include <linux/math64.h>
+#include <linux/rcupdate.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
+#include <linux/kref.h>
+#include <linux/export.h>
+
+#if IS_REACHABLE(CONFIG_HD44780_COMMON)
+#include "charlcd.h"
+#include "hd44780_common.h"
+#endif
 
 #include "lcd1602a-i2c-ioctls.h"
+#include "lcd1602a-i2c.h"
 
 /***** PCF8574 to LCD1602A pin-mapping *****/
 
@@ -58,7 +84,7 @@
 #define DDRAM_ADDR                     GENMASK(6,0)
 #define DDRAM_1ROW_OFFSET              0
 #define DDRAM_2ROW_OFFSET              0x40
-#define DDRAM_ROW_LENGTH               16
+#define DDRAM_ROW_LENGTH               40 /* in 2-row mode */
 /* For Read Busy Flags and Current Address */
 #define LCD_IS_BUSY                    BIT(7)
 #define LCD_CURRENT_ADDR               GENMASK(6,0)
@@ -82,6 +108,9 @@
 #define CMD_4BIT_2ROWS                 (CMD_GP_FUNCTION_SET | CMD_2ROWS_MODE)
 #define CMD_SET_POS_1ROW_BASE          (CMD_GP_SET_DDRAM_ADDR | DDRAM_1ROW_OFFSET)
 #define CMD_SET_POS_2ROW_BASE          (CMD_GP_SET_DDRAM_ADDR | DDRAM_2ROW_OFFSET)
+/* Display shift left shows the next DDRAM column on the right edge */
+#define CMD_VIEW_NEXT_COL              (CMD_GP_CURSOR_DISLAY_SHIFT | CMD_DISPLAY_OR_CURSOR_SHIFT)
+#define CMD_VIEW_PREV_COL              (CMD_GP_CURSOR_DISLAY_SHIFT | CMD_DISPLAY_OR_CURSOR_SHIFT | CMD_SHIFT_R)
 
 /***** Driver's data *****/
 
@@ -90,23 +119,264 @@
 #define LCD_MINOR_BASE                 0
 #define LCD_MINOR_COUNT                1
 
-#define LCD_OPENED_FLAG                0
 #define LCD_VISIBLE_FLAG               1
 #define LCD_BACKLIGHT_FLAG             2
 #define LCD_CURSOR_FLAG                3
 #define LCD_NO_DEBOUNCE_FLAG           4
+#define LCD_I2C_BATCH_FLAG             5
+#define LCD_COMMIT_PENDING_FLAG        7
+#define LCD_CHARLCD_FLAG               8
+#define LCD_PAGE_FLIP_FLAG             9
+
+#define LCD_ROWS                       2
+#define LCD_COLS                       16 /* visible part of a DDRAM row */
+#define LCD_BACK_PAGE                  LCD_COLS /* first DDRAM column of the hidden page */
+
+/* Button gestures defaults */
+#define LCD_BTN_DEFAULT_CODE           BTN_0
+#define LCD_BTN_LONG_PRESS_MS          1000
+#define LCD_BTN_DOUBLE_CLICK_MS        400
+
+/* Backlight software PWM */
+#define LCD_BL_MAX_BRIGHTNESS          16
+#define LCD_BL_PWM_HZ                  100
+#define LCD_BL_DEFAULT_MAX_WRITES      (2 * LCD_BL_PWM_HZ) /* PWM bus writes per second */
+
+/* Max number of display operations in one LCD_IOC_BATCH call */
+#define LCD_BATCH_MAX_OPS              32
+
+/* Virtual file geometry: 2 rows by 17 chars, the 17th char is always '\n'.
+ * Rows are 41 chars long in viewport mode, these are the maximums. */
+#define LCD_VIRT_ROW_SIZE              (DDRAM_ROW_LENGTH + 1)
+#define LCD_VIRT_WRITE_SIZE            (2 * LCD_VIRT_ROW_SIZE - 1)
+
+/* Driver-owned CGRAM glyph sets */
+#define LCD_GLYPHS_NONE                0 /* CGRAM is loaded by users */
+#define LCD_GLYPHS_BARS                1
+#define LCD_GLYPHS_BIG_DIGITS          2
+
+/* Bar widgets: a cell is filled in 5 steps, by pixel columns or rows */
+#define LCD_BAR_STEPS                  5
+#define LCD_HBAR_FIRST_GLYPH           0
+#define LCD_VBAR_FIRST_GLYPH           (LCD_BAR_STEPS - 1)
+#define LCD_CHAR_FULL_BLOCK            0xff /* in both HD44780 character ROMs */
+#define LCD_PROGRESS_TEXT_LEN          4
+
+/* Big numbers: a digit is 3 columns by 2 rows followed by a blank column */
+#define LCD_BIG_DIGIT_COLS             3
+#define LCD_BIG_DIGIT_PITCH            (LCD_BIG_DIGIT_COLS + 1)
+#define LCD_BIG_BLANK                  10
+#define LCD_BIG_MINUS                  11
+
+/* Priority of a newly opened file */
+#define LCD_PRIORITY_DEFAULT           0
+
+/* Status line template set through sysfs */
+#define LCD_TEMPLATE_SIZE              128
+#define LCD_FIELDS_MAX                 8
+#define LCD_FIELD_NAME_LEN             16
+
+/* Max number of writes queued for the bus owner (bits of updates_used) */
+#define LCD_UPDATES_MAX                8
+
+/* Screen snapshots reused round-robin after an RCU grace period */
+#define LCD_SNAPSHOTS                  8
+
+/* Raw PCF8574 bytes sent in one I2C transaction: 4 bytes per HD44780 cmd/data.
+ * Enough for a full frame with set-address before every cell plus cursor sync. */
+#define LCD_BATCH_SIZE                 (4 * (2 * LCD_ROWS * DDRAM_ROW_LENGTH + 1))
+
+/* Commit planner cost model: a HD44780 cmd/data byte takes 4 PCF8574 bytes,
+ * a PCF8574 byte takes 9 clocks at 100 kHz. */
+#define LCD_COST_BUS_BYTE_US           90
+#define LCD_COST_LCD_BYTE_US           (4 * LCD_COST_BUS_BYTE_US)
+#define LCD_COST_CLEAR_US              (CLEAR_SLEEP_MS * USEC_PER_MSEC)
+
+struct lcd1602a_button
+{
+    struct input_dev *input;
+    struct timer_list long_timer;
+    struct hrtimer debounce_timer; /* software debounce if GPIO can't do it */
+    struct work_struct debounce_work;
+    ktime_t debounce;
+    ktime_t first_edge;            /* start of the current bounce burst */
+    atomic_t filtered_edges;
+    u32 latency_last_us;
+    u32 latency_max_us;
+    unsigned int code;             /* reported on every press/release */
+    unsigned int long_code;        /* 0 = no long-press detection */
+    unsigned int double_code;      /* 0 = no double-click detection */
+    unsigned long long_period;     /* in jiffies */
+    unsigned long double_period;   /* in jiffies */
+    unsigned long last_press;      /* jiffies of the first click */
+    bool double_armed;
+    bool pressed;
+    bool toggle;                   /* toggle display visibility on press */
+};
+
+struct lcd1602a_backlight
+{
+    struct backlight_device *bd;
+    struct hrtimer pwm_timer;
+    struct work_struct pwm_work;
+    spinlock_t lock;               /* protects levels and fade state */
+    int level;                     /* current brightness */
+    int target;                    /* brightness at the end of the fade */
+    int fade_from;
+    ktime_t fade_start;
+    u32 fade_ms;
+    bool phase_on;
+    u32 max_writes;                /* PWM bus bandwidth cap, writes per second */
+    unsigned long window_start;    /* jiffies of the current 1 sec window */
+    u32 window_writes;
+    atomic_t writes;
+    atomic_t folded;               /* PWM edges skipped because of a transfer in flight */
+};
+
+/* Last state set in HD44780 registers, so no-op commands aren't sent again.
+ * Command fields hold the whole last cmd of its group, -1 = unknown. */
+struct lcd1602a_regs
+{
+    s16 display_ctrl;
+    s16 entry_mode;
+    s16 function_set;
+    s16 shift;                     /* display shift in columns, -1 = unknown */
+    bool cgram;                    /* address counter points to CGRAM */
+    u8 cgram_addr;
+    atomic_t skipped;              /* redundant cmds not sent */
+};
+
+/* Copy of the DDRAM mirror published by RCU for lock-free readers */
+struct lcd1602a_snapshot
+{
+    unsigned long rcu_cookie;      /* grace period which has to pass before reuse */
+    struct rcu_head rcu;           /* frees a snapshot which isn't from the pool */
+    bool pooled;
+    unsigned int view_offset;
+    u8 cells[LCD_ROWS][DDRAM_ROW_LENGTH];
+};
+
+/* Timed notification shown above all clients' content */
+struct lcd1602a_overlay
+{
+    struct delayed_work expire_work;
+    bool active;
+    u8 cells[LCD_ROWS][DDRAM_ROW_LENGTH];
+    u8 mask[LCD_ROWS][DDRAM_ROW_LENGTH];  /* cells covered by the overlay */
+};
+
+/* Per open file state. Every client draws into its own buffer and the
+ * content of the top priority one is shown, see lcd1602a_compose(). */
+struct lcd1602a_client
+{
+    struct list_head node;         /* in priv->clients, under bus_lock */
+    struct lcd1602a_data *priv;
+    int priority;
+    u64 stamp;                     /* order of the last update, the latest wins a tie */
+    bool active;                   /* has drawn anything, so competes for the screen */
+    bool composing;                /* between LCD_IOC_FRAME_BEGIN and LCD_IOC_FRAME_COMMIT */
+    bool rendered;                 /* has writes in the current update_work run */
+    int update_err;                /* bus error of the client's queued writes, reported by write() */
+    loff_t cursor_pos;             /* LCD's cursor position while this content is shown */
+    struct lcd_region region;      /* part of the screen behind the file */
+    u8 cells[LCD_ROWS][DDRAM_ROW_LENGTH];
+    u8 frame[LCD_ROWS][DDRAM_ROW_LENGTH]; /* frame being composed */
+    struct lcd_widget widgets[LCD_WIDGETS_MAX]; /* last set of each id */
+    struct lcd_clock clock;        /* empty format = no clock */
+};
+
+/* Named cells of the status line template, "{name:width}" in the template */
+struct lcd1602a_field
+{
+    char name[LCD_FIELD_NAME_LEN];
+    u8 row;
+    u8 col;
+    u8 width;
+};
+
+/* Status line drawn by the driver itself. Its client competes with open
+ * files like any other one while a template is set. */
+struct lcd1602a_status
+{
+    struct lcd1602a_client client;
+    char tmpl[LCD_TEMPLATE_SIZE];  /* "" = no status line */
+    struct lcd1602a_field fields[LCD_FIELDS_MAX];
+    int nr_fields;
+};
+
+/* Client of another kernel driver, see lcd1602a-i2c.h */
+struct lcd1602a_handle
+{
+    struct lcd1602a_client client;
+};
+
+/* Write queued by a producer, rendered by lcd1602a_update_work() */
+struct lcd1602a_update
+{
+    struct llist_node node;
+    struct lcd1602a_client *client;
+    loff_t pos;
+    size_t len;
+    u8 data[LCD_VIRT_WRITE_SIZE];
+};
 
 struct lcd1602a_data
 {
+    struct kref ref;               /* probe, open files and in-kernel handles */
+    struct list_head node;         /* in lcd1602a_devices */
+    bool removed;                  /* LCD must not be touched, set under bus_lock */
     unsigned long state_flags;
     struct device *dev;
     struct i2c_client *client;
-    struct cdev cdev;
-    struct mutex lock;
+    struct cdev *cdev;             /* freed by its last user, priv may go first */
+    struct mutex bus_lock;         /* LCD transfers and everything they change */
     int irq;
     struct gpio_desc *btn;
+    struct lcd1602a_button button;
+    struct lcd1602a_backlight bl;
+    struct llist_head updates;     /* lock-free, drained by update_work only */
+    struct lcd1602a_update update_pool[LCD_UPDATES_MAX];
+    unsigned long updates_used;    /* taken records of update_pool */
+    atomic_t nr_updates;           /* queued but not rendered yet */
+    atomic_t toggle_reqs;          /* display on/off toggles requested by the button */
+    struct work_struct update_work;
+    wait_queue_head_t wqueue_wait;
+    u8 front[LCD_ROWS][DDRAM_ROW_LENGTH]; /* LCD's DDRAM mirror */
+    struct lcd1602a_snapshot __rcu *snap; /* last published front[] */
+    struct lcd1602a_snapshot snap_pool[LCD_SNAPSHOTS];
+    int snap_next;
+    struct dentry *debugfs;
+    u8 back[LCD_ROWS][DDRAM_ROW_LENGTH];  /* next frame to commit */
+    u8 base[LCD_ROWS][DDRAM_ROW_LENGTH];  /* top client's content, the screen without overlay */
+    struct list_head clients;      /* open files, under bus_lock */
+    u64 stamp;                     /* last client's update stamp */
+    struct lcd1602a_overlay overlay;   /* under bus_lock */
+    u8 batch[LCD_BATCH_SIZE];
+    int batch_len;
+    unsigned int max_fps;          /* 0 = no refresh rate limit */
+    unsigned long frame_period;    /* in jiffies */
+    unsigned long last_commit;     /* jiffies of the last frame sent */
+    loff_t cursor_pos;             /* cursor position for the deferred commit */
+    int addr_pos;                  /* LCD's address counter as DDRAM position, -1 = unknown */
+    struct lcd1602a_regs regs;     /* under bus_lock */
+    int glyphs;                    /* LCD_GLYPHS_* set in CGRAM, under bus_lock */
+    unsigned int glyph_users;      /* widgets using the set */
+    struct lcd_region screen;      /* DDRAM columns in use, the whole virtual file */
+    unsigned int page;             /* DDRAM column of the file's column 0 */
+    unsigned int view_offset;      /* first visible column of the file */
+    struct delayed_work commit_work;
+    unsigned int clocks;           /* files with a clock, under bus_lock */
+    struct delayed_work clock_work;
+    struct lcd1602a_status status; /* under bus_lock */
+#if IS_REACHABLE(CONFIG_HD44780_COMMON)
+    struct charlcd *charlcd;
+#endif
 };
 
+/* Probed LCDs for in-kernel clients looking for their display */
+static LIST_HEAD(lcd1602a_devices);
+static DEFINE_MUTEX(lcd1602a_devices_lock);
+
 /* default to dynamic major allocation */
 static int major;
 module_param(major, int, 0);
@@ -116,8 +386,98 @@ static bool cursor_init;
 module_param (cursor_init, bool, S_IRUGO);
 MODULE_PARM_DESC (cursor_init, "Enable line cursor during initialization");
 
+static bool charlcd;
+module_param (charlcd, bool, S_IRUGO);
+MODULE_PARM_DESC (charlcd, "Register LCD as auxdisplay charlcd backend instead of own text interface");
+
+static unsigned int max_fps;
+module_param (max_fps, uint, S_IRUGO);
+MODULE_PARM_DESC (max_fps, "Initial refresh rate limit in frames per second (0 = unlimited)");
+
+static bool viewport;
+module_param (viewport, bool, S_IRUGO);
+MODULE_PARM_DESC (viewport, "Use all 40 DDRAM columns of a row, 16 of them are shown from the viewport offset");
+
+static bool page_flip;
+module_param (page_flip, bool, S_IRUGO);
+MODULE_PARM_DESC (page_flip, "Draw frames in hidden DDRAM columns and show them by display shift (not with viewport)");
+
 /***** Low-level I/O methods *****/
 
+static void lcd1602a_regs_invalidate(struct lcd1602a_data *priv)
+{
+    priv->regs.display_ctrl = -1;
+    priv->regs.entry_mode = -1;
+    priv->regs.function_set = -1;
+    priv->regs.shift = -1;
+    priv->regs.cgram = false;
+    priv->addr_pos = -1;
+}
+
+/* Mirror field of a state-setting cmd, NULL for cmds which always act */
+static s16 *lcd1602a_regs_field(struct lcd1602a_data *priv, u8 cmd)
+{
+    switch (cmd ? fls(cmd) - 1 : -1) {
+    case 2:
+        return &priv->regs.entry_mode;
+    case 3:
+        return &priv->regs.display_ctrl;
+    case 5:
+        return &priv->regs.function_set;
+    default:
+        return NULL;
+    }
+}
+
+/* Must be called before the cmd is queued. Set CGRAM address is also
+ * skipped if the address counter already points there. */
+static bool lcd1602a_cmd_is_noop(struct lcd1602a_data *priv, u8 cmd)
+{
+    s16 *field = lcd1602a_regs_field(priv, cmd);
+
+    if ((field && *field == cmd) ||
+        ((cmd & ~(CMD_GP_SET_CGRAM_ADDR - 1)) == CMD_GP_SET_CGRAM_ADDR &&
+         priv->regs.cgram && priv->regs.cgram_addr == (cmd & (CMD_GP_SET_CGRAM_ADDR - 1)))) {
+        atomic_inc(&priv->regs.skipped);
+        return true;
+    }
+
+    return false;
+}
+
+/* Follow HD44780 state after a cmd/data byte is queued */
+static void lcd1602a_regs_update(struct lcd1602a_data *priv, u8 byte, bool not_cmd)
+{
+    s16 *field;
+
+    if (not_cmd) {
+        if (priv->regs.cgram)
+            priv->regs.cgram_addr = (priv->regs.cgram_addr + 1) & (CMD_GP_SET_CGRAM_ADDR - 1);
+        return;
+    }
+
+    field = lcd1602a_regs_field(priv, byte);
+    if (field) {
+        *field = byte;
+    } else if (byte & CMD_GP_SET_DDRAM_ADDR) {
+        priv->regs.cgram = false;
+    } else if (byte & CMD_GP_SET_CGRAM_ADDR) {
+        priv->regs.cgram = true;
+        priv->regs.cgram_addr = byte & (CMD_GP_SET_CGRAM_ADDR - 1);
+    } else if (byte & CMD_GP_CURSOR_DISLAY_SHIFT) {
+        if ((byte & CMD_DISPLAY_OR_CURSOR_SHIFT) && priv->regs.shift >= 0)
+            priv->regs.shift = (priv->regs.shift + ((byte & CMD_SHIFT_R) ? DDRAM_ROW_LENGTH - 1 : 1)) %
+                               DDRAM_ROW_LENGTH;
+    } else if (byte & (CMD_GP_CLEAR_DISPLAY | CMD_GP_RETURN_HOME)) {
+        /* Both go to DDRAM address 0 and cancel display shift,
+         * clear also sets increment mode */
+        priv->regs.cgram = false;
+        priv->regs.shift = 0;
+        if ((byte & CMD_GP_CLEAR_DISPLAY) && priv->regs.entry_mode >= 0)
+            priv->regs.entry_mode |= CMD_CURSOR_INCREMENT;
+    }
+}
+
 static void lcd1602a_error_recovery(struct lcd1602a_data *priv)
 {
     u8 byte = 0;
@@ -126,6 +486,9 @@ static void lcd1602a_error_recovery(struct lcd1602a_data *priv)
 
     /* Yes, without any error-checks - we're in error situation already */
     i2c_smbus_write_byte(priv->client, byte);
+
+    /* Transfer could be cut in the middle */
+    lcd1602a_regs_invalidate(priv);
 }
 
 static int lcd1602a_read_nibble(struct lcd1602a_data *priv, u8 ctrl_half)
@@ -223,76 +586,230 @@ static int lcd1602a_send_byte_common(struct lcd1602a_data *priv, u8 byte, bool n
 
     /* send lower 4 bits of cmd */
     ret = lcd1602a_write_nibble(priv, (byte << 4), ctrl_flags);
+    if (ret)
+        return ret;
+
+    lcd1602a_regs_update(priv, byte, not_cmd);
     return ret;
 }
 
 static inline int lcd1602a_send_cmd(struct lcd1602a_data *priv, u8 cmd)
 {
+    if (lcd1602a_cmd_is_noop(priv, cmd))
+        return 0;
+
     return lcd1602a_send_byte_common(priv, cmd, 0);
 }
 
-static inline int lcd1602a_send_data(struct lcd1602a_data *priv, u8 data)
+static int lcd1602a_batch_flush(struct lcd1602a_data *priv)
+{
+    int i, ret = 0;
+    bool bl_on = test_bit(LCD_BACKLIGHT_FLAG, &priv->state_flags);
+
+    if (!priv->batch_len)
+        return 0;
+
+    /* PWM edges folded while the bytes were queued are carried by the
+     * transfer, so BL_PIN takes the current phase */
+    for (i = 0; i < priv->batch_len; i++)
+        priv->batch[i] = (bl_on) ? (priv->batch[i] | BL_PIN) : (priv->batch[i] & ~BL_PIN);
+
+    if (test_bit(LCD_I2C_BATCH_FLAG, &priv->state_flags)) {
+        ret = i2c_master_send(priv->client, priv->batch, priv->batch_len);
+        if (ret == priv->batch_len)
+            ret = 0;
+        else if (ret >= 0)
+            ret = -EIO;
+    } else {
+        for (i = 0; i < priv->batch_len && !ret; i++)
+            ret = i2c_smbus_write_byte(priv->client, priv->batch[i]);
+    }
+
+    /* Edge which came during the transfer, the last byte has E low so
+     * resending it changes BL_PIN only */
+    if (!ret && bl_on != test_bit(LCD_BACKLIGHT_FLAG, &priv->state_flags))
+        ret = i2c_smbus_write_byte(priv->client, priv->batch[priv->batch_len - 1] ^ BL_PIN);
+
+    priv->batch_len = 0;
+    if (ret)
+        goto i2c_batch_err;
+
+    usleep_range(USUAL_SLEEP_US_MIN, USUAL_SLEEP_US_MAX);
+    return 0;
+
+i2c_batch_err:
+    dev_err(priv->dev, "I2C batch write error (code = %d)!\n", ret);
+    lcd1602a_error_recovery(priv);
+    return ret;
+}
+
+/* Queue E strobe of a nibble into the batch. Every I2C byte takes longer
+ * than HD44780 execution time, so no sleeping between nibbles is needed. */
+static int lcd1602a_batch_nibble(struct lcd1602a_data *priv, u8 data_half, u8 ctrl_half)
+{
+    int ret;
+    u8 byte = (data_half & 0xf0) | (ctrl_half & 0x0f);
+    if (test_bit(LCD_BACKLIGHT_FLAG, &priv->state_flags))
+        byte |= BL_PIN;
+
+    if (priv->batch_len + 2 > LCD_BATCH_SIZE) {
+        ret = lcd1602a_batch_flush(priv);
+        if (ret)
+            return ret;
+    }
+
+    priv->batch[priv->batch_len++] = byte | E_PIN;
+    priv->batch[priv->batch_len++] = byte & ~E_PIN;
+    return 0;
+}
+
+/* Queue cmd/data byte into the batch */
+static int lcd1602a_batch_byte(struct lcd1602a_data *priv, u8 byte, bool not_cmd)
 {
-    return lcd1602a_send_byte_common(priv, data, 1);
+    int ret;
+    u8 ctrl_flags = 0;
+
+    if (not_cmd)
+        ctrl_flags |= RS_PIN;
+    else if (lcd1602a_cmd_is_noop(priv, byte))
+        return 0;
+
+    ret = lcd1602a_batch_nibble(priv, (byte & 0xf0), ctrl_flags);
+    if (ret)
+        return ret;
+
+    ret = lcd1602a_batch_nibble(priv, (byte << 4), ctrl_flags);
+    if (ret)
+        return ret;
+
+    /* Failed flush of the batch invalidates the mirror anyway */
+    lcd1602a_regs_update(priv, byte, not_cmd);
+    return 0;
 }
 
 /***** Basic LCD communication methods *****/
 
-static int lcd1602a_get_current_address(struct lcd1602a_data *priv)
+/* Must be called with priv->bus_lock held. Snapshots are preallocated and
+ * reused round-robin, the oldest one has almost always left its grace period.
+ * When frames come faster than that, a spare one is allocated and freed by
+ * RCU, so the writer doesn't wait for readers. */
+static void lcd1602a_snapshot_publish(struct lcd1602a_data *priv)
 {
-    int ret = lcd1602a_rcv_byte_common(priv, 0);
-    if (ret < 0) {
-        dev_err(priv->dev, "Failed to get LCD's current address! (code = %d)\n", ret);
-        return ret;
+    int row, col;
+    struct lcd1602a_snapshot *old, *snap = &priv->snap_pool[priv->snap_next];
+
+    if (poll_state_synchronize_rcu(snap->rcu_cookie)) {
+        priv->snap_next = (priv->snap_next + 1) % LCD_SNAPSHOTS;
+    } else {
+        snap = kmalloc(sizeof(*snap), GFP_NOWAIT);
+        if (!snap) {
+            /* Out of memory, the pool's one is the only choice */
+            snap = &priv->snap_pool[priv->snap_next];
+            priv->snap_next = (priv->snap_next + 1) % LCD_SNAPSHOTS;
+            cond_synchronize_rcu(snap->rcu_cookie);
+        } else {
+            snap->pooled = false;
+        }
     }
 
-    return (ret & LCD_CURRENT_ADDR);
+    /* Readers see the DDRAM rows from the shown page on */
+    for (row = 0; row < LCD_ROWS; row++)
+        for (col = 0; col < DDRAM_ROW_LENGTH; col++)
+            snap->cells[row][col] = priv->front[row][(priv->page + col) % DDRAM_ROW_LENGTH];
+    snap->view_offset = priv->view_offset;
+    old = rcu_replace_pointer(priv->snap, snap, lockdep_is_held(&priv->bus_lock));
+    if (old && old->pooled)
+        old->rcu_cookie = get_state_synchronize_rcu();
+    else if (old)
+        kfree_rcu(old, rcu);
 }
 
-static int lcd1602a_set_current_address(struct lcd1602a_data *priv, unsigned int pos)
+/* Copy the last published screen, never waits for writers */
+static void lcd1602a_snapshot_read(struct lcd1602a_data *priv, struct lcd1602a_snapshot *copy)
 {
-    int ret;
-    u8 cmd = 0;
+    struct lcd1602a_snapshot *snap;
 
-    if (pos <= DDRAM_ROW_LENGTH) {
-        cmd |= CMD_SET_POS_1ROW_BASE + pos;
-    } else if ((pos > DDRAM_ROW_LENGTH) && (pos <= 2 * DDRAM_ROW_LENGTH + 1)) {
-        cmd |= CMD_SET_POS_2ROW_BASE + (pos - DDRAM_ROW_LENGTH - 1);
+    rcu_read_lock();
+    snap = rcu_dereference(priv->snap);
+    if (snap) {
+        memcpy(copy, snap, sizeof(*copy));
     } else {
-        ret = -ENOSPC;
+        copy->view_offset = 0;
+        memset(copy->cells, ' ', sizeof(copy->cells));
     }
+    rcu_read_unlock();
+}
 
-    ret = lcd1602a_send_cmd(priv, cmd);
-    if (ret)
-        goto lcd_set_addr_err;
+/* Visible part of the snapshot, DDRAM rows wrap around under display shift */
+static void lcd1602a_snapshot_view(const struct lcd1602a_snapshot *snap, u8 cells[LCD_ROWS][LCD_COLS])
+{
+    int row, col;
 
-    return ret;
+    for (row = 0; row < LCD_ROWS; row++)
+        for (col = 0; col < LCD_COLS; col++)
+            cells[row][col] = snap->cells[row][(snap->view_offset + col) % DDRAM_ROW_LENGTH];
+}
 
-lcd_set_addr_err:
-    dev_err(priv->dev, "Failed to set current address for LCD! (code = %d)\n", ret);
-    return ret;
+/* Virtual file of a region is made of rows of 'cols' chars followed by '\n' */
+static inline int lcd1602a_rgn_row_size(const struct lcd_region *rgn)
+{
+    return rgn->cols + 1;
 }
 
-static int lcd1602a_getchar(struct lcd1602a_data *priv)
+static inline int lcd1602a_rgn_write_size(const struct lcd_region *rgn)
 {
-    int ret = lcd1602a_rcv_byte_common(priv, 1);
-    if (ret < 0)
-        dev_err(priv->dev, "Failed to get LCD's data byte! (code = %d)\n", ret);
+    return rgn->rows * lcd1602a_rgn_row_size(rgn) - 1;
+}
 
-    return ret;
+/* DDRAM position is row * LCD_VIRT_ROW_SIZE + DDRAM column. The file's
+ * column 0 is at the current page. */
+static int lcd1602a_pos_to_ddram(struct lcd1602a_data *priv, loff_t pos)
+{
+    int row_size = lcd1602a_rgn_row_size(&priv->screen);
+
+    return (pos / row_size) * LCD_VIRT_ROW_SIZE + priv->page + pos % row_size;
 }
 
-static int lcd1602a_putchar(struct lcd1602a_data *priv, u8 ch)
+/* Address out of the page is reported as EOF */
+static loff_t lcd1602a_ddram_to_pos(struct lcd1602a_data *priv, int addr)
 {
-    int ret = lcd1602a_send_data(priv, ch);
-    if (ret)
-        goto lcd_putchar_err;
+    int row = addr / LCD_VIRT_ROW_SIZE;
+    int col = addr % LCD_VIRT_ROW_SIZE - priv->page;
 
-    return ret;
+    if (row >= LCD_ROWS || col < 0 || col > priv->screen.cols)
+        return lcd1602a_rgn_write_size(&priv->screen) + 1;
 
-lcd_putchar_err:
-    dev_err(priv->dev, "Failed to send data byte to LCD! (code = %d)\n", ret);
-    return ret;
+    return row * lcd1602a_rgn_row_size(&priv->screen) + col;
+}
+
+/* Convert DDRAM position into Set DDRAM address cmd */
+static int lcd1602a_pos_to_cmd(unsigned int pos)
+{
+    static const u8 row_base[LCD_ROWS] = { CMD_SET_POS_1ROW_BASE, CMD_SET_POS_2ROW_BASE };
+    unsigned int row = pos / LCD_VIRT_ROW_SIZE;
+    unsigned int col = pos % LCD_VIRT_ROW_SIZE;
+
+    if (row >= LCD_ROWS)
+        return -ENOSPC;
+
+    /* Address counter goes on with the other row after the last DDRAM column */
+    if (col == DDRAM_ROW_LENGTH) {
+        row = (row + 1) % LCD_ROWS;
+        col = 0;
+    }
+
+    return row_base[row] + col;
+}
+
+static int lcd1602a_get_current_address(struct lcd1602a_data *priv)
+{
+    int ret = lcd1602a_rcv_byte_common(priv, 0);
+    if (ret < 0) {
+        dev_err(priv->dev, "Failed to get LCD's current address! (code = %d)\n", ret);
+        return ret;
+    }
+
+    return (ret & LCD_CURRENT_ADDR);
 }
 
 static int lcd1602a_clear(struct lcd1602a_data *priv)
@@ -302,6 +819,11 @@ static int lcd1602a_clear(struct lcd1602a_data *priv)
         goto lcd_clear_err;
 
     msleep(CLEAR_SLEEP_MS);
+    priv->addr_pos = 0;
+    priv->page = 0;
+
+    memset(priv->front, ' ', sizeof(priv->front));
+    lcd1602a_snapshot_publish(priv);
     return ret;
 
 lcd_clear_err:
@@ -353,428 +875,2877 @@ lcd_cursor_err:
     return ret;
 }
 
-static int lcd1602a_init(struct lcd1602a_data *priv)
+static int lcd1602a_cgram_op(struct lcd1602a_data *priv, unsigned int index, const u8 *pattern)
 {
-    /* Sync LCD and force to 4-bit mode by magic sequence */
-    int ret = lcd1602a_write_nibble(priv, CMD_GP_FUNCTION_SET | CMD_8BIT_DATA_MODE, 0);
-    if (ret)
-        goto lcd_init_err;
+    int i, ret, pos;
 
-    msleep(INIT_FIRST_SLEEP_MS);
+    if (index >= LCD_CGRAM_CHARS)
+        return -EINVAL;
 
-    ret = lcd1602a_write_nibble(priv, CMD_GP_FUNCTION_SET | CMD_8BIT_DATA_MODE, 0);
+    ret = lcd1602a_batch_byte(priv, CMD_GP_SET_CGRAM_ADDR | (index << CGRAM_LOCATION_SHIFT), 0);
     if (ret)
-        goto lcd_init_err;
-
-    usleep_range(INIT_SECOND_SLEEP_US_MIN, INIT_SECOND_SLEEP_US_MAX);
+        goto lcd_cgram_err;
 
-    ret = lcd1602a_write_nibble(priv, CMD_GP_FUNCTION_SET | CMD_8BIT_DATA_MODE, 0);
-    if (ret)
-        goto lcd_init_err;
+    for (i = 0; i < LCD_CGRAM_ROWS; i++) {
+        ret = lcd1602a_batch_byte(priv, pattern[i] & LCD_CGRAM_ROW_MASK, 1);
+        if (ret)
+            goto lcd_cgram_err;
+    }
 
-    ret = lcd1602a_write_nibble(priv, CMD_GP_FUNCTION_SET, 0);
-    if (ret)
-        goto lcd_init_err;
+    /* Visible cursor follows the address counter, so it goes back to DDRAM
+     * at once. Otherwise the next frame sets DDRAM address anyway and
+     * glyphs loaded one after another need no set CGRAM address. */
+    pos = -1;
+    if (test_bit(LCD_CURSOR_FLAG, &priv->state_flags)) {
+        pos = lcd1602a_pos_to_ddram(priv, min_t(loff_t, priv->cursor_pos,
+                                                lcd1602a_rgn_write_size(&priv->screen) - 1));
+        ret = lcd1602a_batch_byte(priv, lcd1602a_pos_to_cmd(pos), 0);
+        if (ret)
+            goto lcd_cgram_err;
+    }
 
-    /* Now we can use regular cmds */
-    ret = lcd1602a_send_cmd(priv, CMD_4BIT_2ROWS);
+    ret = lcd1602a_batch_flush(priv);
     if (ret)
-        goto lcd_init_err;
+        goto lcd_cgram_err;
 
-    ret = lcd1602a_send_cmd(priv, CMD_SHIFT_CURSOR_R);
-    if (ret)
-        goto lcd_init_err;
+    priv->addr_pos = pos;
+    return ret;
 
-    ret = lcd1602a_cursor_op(priv, cursor_init);
-    if (ret)
-        goto lcd_init_err;
+lcd_cgram_err:
+    priv->batch_len = 0;
+    dev_err(priv->dev, "Failed to load LCD's CGRAM! (code = %d)\n", ret);
+    return ret;
+}
 
-    ret = lcd1602a_clear(priv);
-    if (ret)
-        goto lcd_init_err;
+/* Bars: pixel columns filled from the left and pixel rows from the bottom,
+ * rows are rounded to 5 steps per cell as well */
+static const u8 lcd1602a_bar_glyphs[LCD_CGRAM_CHARS][LCD_CGRAM_ROWS] = {
+    { [0 ... 7] = 0x10 },
+    { [0 ... 7] = 0x18 },
+    { [0 ... 7] = 0x1c },
+    { [0 ... 7] = 0x1e },
+    { [6 ... 7] = 0x1f },
+    { [5 ... 7] = 0x1f },
+    { [3 ... 7] = 0x1f },
+    { [2 ... 7] = 0x1f },
+};
 
-    ret = lcd1602a_backlight_op(priv, 1);
-    if (ret)
-        goto lcd_init_err;
+/* Segments of big digits: rounded corners, upper/lower bars and both */
+enum {
+    BIG_LT, BIG_UB, BIG_RT, BIG_LL, BIG_LB, BIG_LR, BIG_UMB, BIG_LMB,
+    BIG_SP = ' ',
+    BIG_FB = LCD_CHAR_FULL_BLOCK,
+};
 
-    set_bit(LCD_VISIBLE_FLAG, &priv->state_flags);
+static const u8 lcd1602a_big_digit_glyphs[LCD_CGRAM_CHARS][LCD_CGRAM_ROWS] = {
+    [BIG_LT] = { 0x07, 0x0f, 0x1f, 0x1f, 0x1f, 0x1f, 0x1f, 0x1f },
+    [BIG_UB] = { 0x1f, 0x1f, 0x1f, 0x00, 0x00, 0x00, 0x00, 0x00 },
+    [BIG_RT] = { 0x1c, 0x1e, 0x1f, 0x1f, 0x1f, 0x1f, 0x1f, 0x1f },
+    [BIG_LL] = { 0x1f, 0x1f, 0x1f, 0x1f, 0x1f, 0x1f, 0x0f, 0x07 },
+    [BIG_LB] = { 0x00, 0x00, 0x00, 0x00, 0x00, 0x1f, 0x1f, 0x1f },
+    [BIG_LR] = { 0x1f, 0x1f, 0x1f, 0x1f, 0x1f, 0x1f, 0x1e, 0x1c },
+    [BIG_UMB] = { 0x1f, 0x1f, 0x1f, 0x00, 0x00, 0x00, 0x1f, 0x1f },
+    [BIG_LMB] = { 0x1f, 0x00, 0x00, 0x00, 0x00, 0x1f, 0x1f, 0x1f },
+};
 
-    return ret;
+static const u8 lcd1602a_big_digits[][LCD_ROWS][LCD_BIG_DIGIT_COLS] = {
+    { { BIG_LT, BIG_UB, BIG_RT }, { BIG_LL, BIG_LB, BIG_LR } },
+    { { BIG_UB, BIG_RT, BIG_SP }, { BIG_LB, BIG_FB, BIG_LB } },
+    { { BIG_UMB, BIG_UMB, BIG_RT }, { BIG_LL, BIG_LB, BIG_LB } },
+    { { BIG_UMB, BIG_UMB, BIG_RT }, { BIG_LB, BIG_LB, BIG_LR } },
+    { { BIG_LL, BIG_LB, BIG_FB }, { BIG_SP, BIG_SP, BIG_FB } },
+    { { BIG_FB, BIG_UMB, BIG_UMB }, { BIG_LB, BIG_LB, BIG_LR } },
+    { { BIG_LT, BIG_UMB, BIG_UMB }, { BIG_LL, BIG_LB, BIG_LR } },
+    { { BIG_UB, BIG_UB, BIG_RT }, { BIG_SP, BIG_SP, BIG_FB } },
+    { { BIG_LT, BIG_UMB, BIG_RT }, { BIG_LL, BIG_LMB, BIG_LR } },
+    { { BIG_LT, BIG_UMB, BIG_RT }, { BIG_SP, BIG_SP, BIG_FB } },
+    [LCD_BIG_BLANK] = { { BIG_SP, BIG_SP, BIG_SP }, { BIG_SP, BIG_SP, BIG_SP } },
+    [LCD_BIG_MINUS] = { { BIG_LB, BIG_LB, BIG_LB }, { BIG_SP, BIG_SP, BIG_SP } },
+};
 
-lcd_init_err:
-    dev_err(priv->dev, "Failed to init LCD! (code = %d)\n", ret);
-    return ret;
-}
+static const u8 (*const lcd1602a_glyph_sets[])[LCD_CGRAM_ROWS] = {
+    [LCD_GLYPHS_BARS] = lcd1602a_bar_glyphs,
+    [LCD_GLYPHS_BIG_DIGITS] = lcd1602a_big_digit_glyphs,
+};
 
-static int lcd1602a_exit(struct lcd1602a_data *priv)
+/* Must be called with priv->bus_lock held. Take a reference to the driver's
+ * glyph set, it is uploaded once if CGRAM holds other glyphs. CGRAM chars
+ * are shown by every cell which refers them, so the set is never replaced
+ * while some widget uses it. */
+static int lcd1602a_glyphs_get(struct lcd1602a_data *priv, int set)
 {
-    int ret = lcd1602a_clear(priv);
-    if (ret)
-        goto lcd_exit_err;
-
-    ret = lcd1602a_send_cmd(priv, CMD_LCD_DISPLAY_OFF);
-    if (ret)
-        goto lcd_exit_err;
+    int i, ret;
 
-    ret = lcd1602a_backlight_op(priv, 0);
-    if (ret)
-        goto lcd_exit_err;
+    if (priv->glyphs != set) {
+        if (priv->glyph_users)
+            return -EBUSY;
 
-    priv->state_flags = 0;
+        /* Partly loaded set is no set */
+        priv->glyphs = LCD_GLYPHS_NONE;
+        for (i = 0; i < LCD_CGRAM_CHARS; i++) {
+            ret = lcd1602a_cgram_op(priv, i, lcd1602a_glyph_sets[set][i]);
+            if (ret)
+                return ret;
+        }
+        priv->glyphs = set;
+    }
 
-    return ret;
+    priv->glyph_users++;
+    return 0;
+}
 
-lcd_exit_err:
-    dev_err(priv->dev, "Failed during LCD's exit routine! (code = %d)\n", ret);
-    return ret;
+static void lcd1602a_glyphs_put(struct lcd1602a_data *priv)
+{
+    priv->glyph_users--;
 }
 
-/***** Threaded IRQ handler *****/
+static const u8 lcd1602a_blank[LCD_ROWS][DDRAM_ROW_LENGTH] = {
+    [0 ... LCD_ROWS - 1] = { [0 ... DDRAM_ROW_LENGTH - 1] = ' ' },
+};
 
-static irqreturn_t lcd1602a_threaded_isr(int irq, void *dev_id)
+/* Move LCD's address counter, and so the cursor, to DDRAM position @cursor
+ * unless it is negative. Returns number of HD44780 cmds. */
+static int lcd1602a_plan_cursor(struct lcd1602a_data *priv, int *addr_pos, int cursor, bool dry_run)
 {
-    int ret = -EFAULT;
-    struct lcd1602a_data *priv = dev_id;
-
-    /* Check if debounce sleeping is needed */
-    if (test_bit(LCD_NO_DEBOUNCE_FLAG, &priv->state_flags))
-        msleep(50);
+    int ret;
 
-    mutex_lock(&priv->lock);
+    if (cursor < 0 || cursor == *addr_pos)
+        return 0;
 
-    if (test_bit(LCD_VISIBLE_FLAG, &priv->state_flags)) {
-        ret = lcd1602a_send_cmd(priv, CMD_LCD_DISPLAY_OFF);
+    if (!dry_run) {
+        ret = lcd1602a_batch_byte(priv, lcd1602a_pos_to_cmd(cursor), 0);
         if (ret)
-            goto lcd_isr_err;
-        clear_bit(LCD_VISIBLE_FLAG, &priv->state_flags);
-    } else {
-        if (test_bit(LCD_CURSOR_FLAG, &priv->state_flags)) {
-            ret = lcd1602a_send_cmd(priv, CMD_LCD_DISPLAY_CURSOR);
-            if (ret)
-                goto lcd_isr_err;
-        } else {
-            ret = lcd1602a_send_cmd(priv, CMD_LCD_DISPLAY_PLAIN);
-            if (ret)
-                goto lcd_isr_err;
-        }
-        set_bit(LCD_VISIBLE_FLAG, &priv->state_flags);
+            return ret;
     }
 
-lcd_isr_err:
-    mutex_unlock(&priv->lock);
-    return IRQ_HANDLED;
+    *addr_pos = cursor;
+    return 1;
 }
 
-/***** File operation methods *****/
-
-static loff_t lcd1602_llseek(struct file *file, loff_t offset, int orig)
+/* Address counter after a char written at DDRAM position @pos. It goes on
+ * with the other row after the last DDRAM column, see lcd1602a_pos_to_cmd(). */
+static int lcd1602a_next_addr_pos(int pos)
 {
-    return fixed_size_llseek(file, offset, orig, 2 * (DDRAM_ROW_LENGTH + 1));
+    int row = pos / LCD_VIRT_ROW_SIZE;
+
+    if (pos % LCD_VIRT_ROW_SIZE == DDRAM_ROW_LENGTH - 1)
+        return ((row + 1) % LCD_ROWS) * LCD_VIRT_ROW_SIZE;
+
+    return pos + 1;
 }
 
-static int lcd1602a_open(struct inode *inode, struct file *filp)
+/* Batch cells of the back buffer which differ from @from and then move LCD's
+ * cursor to DDRAM position @cursor. The frame goes to DDRAM columns from
+ * @page on. *@addr_pos is LCD's address counter (-1 = unknown), it is
+ * advanced the same way as the LCD does with auto-increment. Set DDRAM
+ * address is sent only when the counter is elsewhere. Only counts if @dry_run.
+ * Returns number of HD44780 cmd/data bytes. */
+static int lcd1602a_plan_diff(struct lcd1602a_data *priv, const u8 from[][DDRAM_ROW_LENGTH],
+                              unsigned int page, int *addr_pos, int cursor, bool dry_run)
 {
-    int ret = -EFAULT;
-    struct lcd1602a_data *priv = container_of(inode->i_cdev, struct lcd1602a_data, cdev);
-
-    if (!test_bit(LCD_VISIBLE_FLAG, &priv->state_flags))
-        return -EIO;
+    int row, col, ret;
+    int pos, bytes = 0;
+    int addr = *addr_pos;
 
-    if (test_and_set_bit(LCD_OPENED_FLAG, &priv->state_flags))
-        return -EBUSY;
+    for (row = 0; row < LCD_ROWS; row++) {
+        for (col = 0; col < priv->screen.cols; col++) {
+            if (priv->back[row][col] == from[row][page + col])
+                continue;
 
-    filp->private_data = priv;
-    filp->f_pos = 0;
+            /* Jump and overwrite of a skipped cell cost the same, jump is never slower */
+            pos = row * LCD_VIRT_ROW_SIZE + page + col;
+            if (pos != addr) {
+                bytes++;
+                if (!dry_run) {
+                    ret = lcd1602a_batch_byte(priv, lcd1602a_pos_to_cmd(pos), 0);
+                    if (ret)
+                        return ret;
+                }
+            }
 
-    mutex_lock(&priv->lock);
+            bytes++;
+            if (!dry_run) {
+                ret = lcd1602a_batch_byte(priv, priv->back[row][col], 1);
+                if (ret)
+                    return ret;
+            }
+            addr = lcd1602a_next_addr_pos(pos);
+        }
+    }
+
+    ret = lcd1602a_plan_cursor(priv, &addr, cursor, dry_run);
+    if (ret < 0)
+        return ret;
+
+    *addr_pos = addr;
+    return bytes + ret;
+}
+
+/* Number of display shifts which move the visible window from DDRAM
+ * column @from to @to the shorter way round */
+static int lcd1602a_shift_count(int from, int to)
+{
+    int cols = (to - from + DDRAM_ROW_LENGTH) % DDRAM_ROW_LENGTH;
+
+    return min(cols, DDRAM_ROW_LENGTH - cols);
+}
+
+/* Must be called with priv->bus_lock held. Queue display shifts which bring
+ * the visible window to the viewport offset: a scroll by one column is one
+ * cmd instead of rewriting the screen. Shift is unknown only after an error,
+ * Return home (executed as long as clear) cancels it then. */
+static int lcd1602a_batch_viewport(struct lcd1602a_data *priv)
+{
+    int ret;
+    int offset = (priv->page + priv->view_offset) % DDRAM_ROW_LENGTH;
+
+    if (priv->regs.shift < 0) {
+        ret = lcd1602a_batch_byte(priv, CMD_GP_RETURN_HOME, 0);
+        if (!ret)
+            ret = lcd1602a_batch_flush(priv);
+        if (ret)
+            return ret;
+
+        msleep(CLEAR_SLEEP_MS);
+        priv->addr_pos = 0;
+    }
+
+    /* Every shift cmd moves regs.shift by one column */
+    while (priv->regs.shift != offset) {
+        if ((offset - priv->regs.shift + DDRAM_ROW_LENGTH) % DDRAM_ROW_LENGTH <= DDRAM_ROW_LENGTH / 2)
+            ret = lcd1602a_batch_byte(priv, CMD_VIEW_NEXT_COL, 0);
+        else
+            ret = lcd1602a_batch_byte(priv, CMD_VIEW_PREV_COL, 0);
+        if (ret)
+            return ret;
+    }
+
+    return 0;
+}
+
+static int lcd1602a_changed_cells(struct lcd1602a_data *priv)
+{
+    int row, col, cells = 0;
+
+    for (row = 0; row < LCD_ROWS; row++)
+        for (col = 0; col < priv->screen.cols; col++)
+            if (priv->back[row][col] != priv->front[row][priv->page + col])
+                cells++;
+
+    return cells;
+}
+
+/* Draw the frame into the hidden page (DDRAM columns not shown) and show it
+ * by display shifts. It all goes in one I2C transaction. Each shift takes
+ * effect as it arrives, ~360 us apart, so the flip takes ~6 ms. That is short
+ * compared with the LCD's response time, the frame isn't seen being rewritten
+ * left to right. The hidden page still holds the frame before the last one,
+ * only cells which differ from it are sent. */
+static int lcd1602a_plan_flip(struct lcd1602a_data *priv, int *addr_pos, loff_t cursor_pos)
+{
+    int ret;
+    unsigned int page = (priv->page) ? 0 : LCD_BACK_PAGE;
+
+    ret = lcd1602a_plan_diff(priv, priv->front, page, addr_pos, -1, false);
+    if (ret < 0)
+        return ret;
+
+    priv->page = page;
+    ret = lcd1602a_batch_viewport(priv);
+    if (ret)
+        return ret;
+
+    if (cursor_pos >= lcd1602a_rgn_write_size(&priv->screen))
+        return 0;
+
+    ret = lcd1602a_plan_cursor(priv, addr_pos, lcd1602a_pos_to_ddram(priv, cursor_pos), false);
+    return (ret < 0) ? ret : 0;
+}
+
+/* Send the back buffer by the cheapest plan and then move LCD's cursor to
+ * @cursor_pos. Either only cells which differ from the front buffer are sent
+ * in a single I2C transaction, or the LCD is cleared first and only non-blank
+ * cells are sent. Clear is a single cmd, but the LCD executes it for 2 ms, so
+ * it pays off for mostly blank frames only. Clear also cancels display shift,
+ * which has to be done again. Return home and cursor shifts cost as much as
+ * set DDRAM address and are never cheaper. With page flipping a frame which
+ * changes more than one cell is drawn off-screen, see lcd1602a_plan_flip(). */
+static int lcd1602a_commit(struct lcd1602a_data *priv, loff_t cursor_pos)
+{
+    int row, ret, diff_bytes, clear_bytes;
+    int addr = priv->addr_pos, clear_addr = 0;
+    int cursor = -1;
+    bool flip = test_bit(LCD_PAGE_FLIP_FLAG, &priv->state_flags);
+    const u8 (*from)[DDRAM_ROW_LENGTH] = priv->front;
+
+    /* Shift is unknown only after an error, the frame is sent in place then */
+    if (flip && priv->regs.shift >= 0 && lcd1602a_changed_cells(priv) > 1) {
+        ret = lcd1602a_plan_flip(priv, &addr, cursor_pos);
+        if (ret)
+            goto lcd_commit_err;
+        goto lcd_commit_flush;
+    }
+
+    if (cursor_pos < lcd1602a_rgn_write_size(&priv->screen))
+        cursor = lcd1602a_pos_to_ddram(priv, cursor_pos);
+
+    diff_bytes = lcd1602a_plan_diff(priv, priv->front, priv->page, &addr, cursor, true) +
+                 lcd1602a_shift_count(max_t(int, priv->regs.shift, 0), priv->page + priv->view_offset);
+    clear_bytes = 1 + lcd1602a_plan_diff(priv, lcd1602a_blank, 0, &clear_addr, cursor, true) +
+                  lcd1602a_shift_count(0, priv->view_offset);
+
+    /* Clear would show the blank screen before the frame is drawn */
+    if (!flip && priv->page == 0 &&
+        clear_bytes * LCD_COST_LCD_BYTE_US + LCD_COST_CLEAR_US < diff_bytes * LCD_COST_LCD_BYTE_US) {
+        ret = lcd1602a_batch_byte(priv, CMD_LCD_CLEAR, 0);
+        if (ret)
+            goto lcd_commit_err;
+
+        ret = lcd1602a_batch_flush(priv);
+        if (ret)
+            goto lcd_commit_err;
+
+        msleep(CLEAR_SLEEP_MS);
+        memset(priv->front, ' ', sizeof(priv->front));
+
+        /* Clear moves the address counter home */
+        from = lcd1602a_blank;
+        priv->addr_pos = 0;
+    }
+
+    ret = lcd1602a_batch_viewport(priv);
+    if (ret)
+        goto lcd_commit_err;
+
+    addr = priv->addr_pos;
+    ret = lcd1602a_plan_diff(priv, from, priv->page, &addr, cursor, false);
+    if (ret < 0)
+        goto lcd_commit_err;
+
+lcd_commit_flush:
+    ret = lcd1602a_batch_flush(priv);
+    if (ret)
+        goto lcd_commit_err;
+
+    priv->addr_pos = addr;
+
+    for (row = 0; row < LCD_ROWS; row++)
+        memcpy(&priv->front[row][priv->page], priv->back[row], priv->screen.cols);
+    lcd1602a_snapshot_publish(priv);
+
+    priv->last_commit = jiffies;
+    return ret;
+
+lcd_commit_err:
+    priv->batch_len = 0;
+    dev_err(priv->dev, "Failed to commit frame to LCD! (code = %d)\n", ret);
+    return ret;
+}
+
+/* Commit the back buffer keeping the refresh rate limit. Updates which come
+ * too fast are coalesced and the newest frame is sent when the period expires. */
+static int lcd1602a_request_commit(struct lcd1602a_data *priv, loff_t cursor_pos)
+{
+    unsigned long frame_period = READ_ONCE(priv->frame_period);
+    unsigned long next_commit = priv->last_commit + frame_period;
+
+    priv->cursor_pos = cursor_pos;
+
+    if (frame_period && time_before(jiffies, next_commit)) {
+        if (!test_and_set_bit(LCD_COMMIT_PENDING_FLAG, &priv->state_flags))
+            schedule_delayed_work(&priv->commit_work, next_commit - jiffies);
+        return 0;
+    }
+
+    clear_bit(LCD_COMMIT_PENDING_FLAG, &priv->state_flags);
+    return lcd1602a_commit(priv, cursor_pos);
+}
+
+/* Both values are read locklessly, each one on its own */
+static void lcd1602a_set_max_fps(struct lcd1602a_data *priv, unsigned int fps)
+{
+    WRITE_ONCE(priv->max_fps, fps);
+    WRITE_ONCE(priv->frame_period, (fps) ? msecs_to_jiffies(DIV_ROUND_UP(MSEC_PER_SEC, fps)) : 0);
+}
+
+/* Must be called with priv->bus_lock held */
+static int lcd1602a_init(struct lcd1602a_data *priv)
+{
+    int ret;
+
+    lcd1602a_regs_invalidate(priv);
+
+    /* Sync LCD and force to 4-bit mode by magic sequence */
+    ret = lcd1602a_write_nibble(priv, CMD_GP_FUNCTION_SET | CMD_8BIT_DATA_MODE, 0);
+    if (ret)
+        goto lcd_init_err;
+
+    msleep(INIT_FIRST_SLEEP_MS);
+
+    ret = lcd1602a_write_nibble(priv, CMD_GP_FUNCTION_SET | CMD_8BIT_DATA_MODE, 0);
+    if (ret)
+        goto lcd_init_err;
+
+    usleep_range(INIT_SECOND_SLEEP_US_MIN, INIT_SECOND_SLEEP_US_MAX);
+
+    ret = lcd1602a_write_nibble(priv, CMD_GP_FUNCTION_SET | CMD_8BIT_DATA_MODE, 0);
+    if (ret)
+        goto lcd_init_err;
+
+    ret = lcd1602a_write_nibble(priv, CMD_GP_FUNCTION_SET, 0);
+    if (ret)
+        goto lcd_init_err;
+
+    /* Now we can use regular cmds */
+    ret = lcd1602a_send_cmd(priv, CMD_4BIT_2ROWS);
+    if (ret)
+        goto lcd_init_err;
+
+    ret = lcd1602a_send_cmd(priv, CMD_SHIFT_CURSOR_R);
+    if (ret)
+        goto lcd_init_err;
+
+    ret = lcd1602a_cursor_op(priv, cursor_init);
+    if (ret)
+        goto lcd_init_err;
+
+    ret = lcd1602a_clear(priv);
+    if (ret)
+        goto lcd_init_err;
+
+    memset(priv->back, ' ', sizeof(priv->back));
+    memset(priv->base, ' ', sizeof(priv->base));
+
+    ret = lcd1602a_backlight_op(priv, 1);
+    if (ret)
+        goto lcd_init_err;
+
+    priv->bl.level = priv->bl.target = LCD_BL_MAX_BRIGHTNESS;
+
+    set_bit(LCD_VISIBLE_FLAG, &priv->state_flags);
+
+    return ret;
+
+lcd_init_err:
+    dev_err(priv->dev, "Failed to init LCD! (code = %d)\n", ret);
+    return ret;
+}
+
+/* Must be called with priv->bus_lock held */
+static int lcd1602a_exit(struct lcd1602a_data *priv)
+{
+    int ret = lcd1602a_clear(priv);
+    if (ret)
+        goto lcd_exit_err;
+
+    ret = lcd1602a_send_cmd(priv, CMD_LCD_DISPLAY_OFF);
+    if (ret)
+        goto lcd_exit_err;
+
+    ret = lcd1602a_backlight_op(priv, 0);
+    if (ret)
+        goto lcd_exit_err;
+
+    priv->state_flags = 0;
+
+    return ret;
+
+lcd_exit_err:
+    dev_err(priv->dev, "Failed during LCD's exit routine! (code = %d)\n", ret);
+    return ret;
+}
+
+/***** Backlight brightness by software PWM *****/
+
+/* Move current brightness towards the target according to the fade time.
+ * Returns true while fading is in progress. */
+static bool lcd1602a_fade_step(struct lcd1602a_backlight *bl)
+{
+    s64 elapsed;
+
+    if (bl->level == bl->target)
+        return false;
+
+    elapsed = ktime_ms_delta(ktime_get(), bl->fade_start);
+    if (!bl->fade_ms || elapsed >= bl->fade_ms) {
+        bl->level = bl->target;
+        return false;
+    }
+
+    bl->level = bl->fade_from + div_s64((s64)(bl->target - bl->fade_from) * elapsed, bl->fade_ms);
+    return true;
+}
+
+static u64 lcd1602a_pwm_period_ns(struct lcd1602a_backlight *bl)
+{
+    /* Every period costs 2 bus writes, lower the frequency to keep the cap */
+    return max_t(u64, NSEC_PER_SEC / LCD_BL_PWM_HZ, div_u64(2 * NSEC_PER_SEC, bl->max_writes));
+}
+
+static enum hrtimer_restart lcd1602a_pwm_timer(struct hrtimer *t)
+{
+    int level;
+    bool fading;
+    u64 period, on_ns;
+    struct lcd1602a_backlight *bl = container_of(t, struct lcd1602a_backlight, pwm_timer);
+    struct lcd1602a_data *priv = container_of(bl, struct lcd1602a_data, bl);
+
+    spin_lock(&bl->lock);
+    fading = lcd1602a_fade_step(bl);
+    level = bl->level;
+    spin_unlock(&bl->lock);
+
+    period = lcd1602a_pwm_period_ns(bl);
+
+    if (level <= 0 || level >= LCD_BL_MAX_BRIGHTNESS) {
+        bl->phase_on = (level > 0);
+        assign_bit(LCD_BACKLIGHT_FLAG, &priv->state_flags, bl->phase_on);
+        queue_work(system_highpri_wq, &bl->pwm_work);
+
+        if (!fading)
+            return HRTIMER_NORESTART;
+
+        hrtimer_forward_now(t, ns_to_ktime(period));
+        return HRTIMER_RESTART;
+    }
+
+    on_ns = div_u64(period * level, LCD_BL_MAX_BRIGHTNESS);
+    bl->phase_on = !bl->phase_on;
+    assign_bit(LCD_BACKLIGHT_FLAG, &priv->state_flags, bl->phase_on);
+    queue_work(system_highpri_wq, &bl->pwm_work);
+
+    hrtimer_forward_now(t, ns_to_ktime((bl->phase_on) ? on_ns : period - on_ns));
+    return HRTIMER_RESTART;
+}
+
+static void lcd1602a_pwm_work(struct work_struct *work)
+{
+    int level;
+    bool steady;
+    struct lcd1602a_backlight *bl = container_of(work, struct lcd1602a_backlight, pwm_work);
+    struct lcd1602a_data *priv = container_of(bl, struct lcd1602a_data, bl);
+
+    level = READ_ONCE(bl->level);
+    steady = (level <= 0 || level >= LCD_BL_MAX_BRIGHTNESS);
+
+    /* Final state must reach the LCD, but a PWM edge is carried by the
+     * BL_PIN of every byte of a transfer in flight. */
+    if (steady) {
+        mutex_lock(&priv->bus_lock);
+    } else if (!mutex_trylock(&priv->bus_lock)) {
+        atomic_inc(&bl->folded);
+        return;
+    }
+
+    if (time_after(jiffies, bl->window_start + HZ)) {
+        bl->window_start = jiffies;
+        bl->window_writes = 0;
+    }
+
+    if (!steady && bl->window_writes >= bl->max_writes)
+        goto pwm_unlock;
+
+    if (!i2c_smbus_write_byte(priv->client, test_bit(LCD_BACKLIGHT_FLAG, &priv->state_flags) ? BL_PIN : 0)) {
+        bl->window_writes++;
+        atomic_inc(&bl->writes);
+    }
+
+pwm_unlock:
+    mutex_unlock(&priv->bus_lock);
+}
+
+static void lcd1602a_set_brightness(struct lcd1602a_data *priv, int level)
+{
+    unsigned long flags;
+    struct lcd1602a_backlight *bl = &priv->bl;
+
+    spin_lock_irqsave(&bl->lock, flags);
+    bl->fade_from = bl->level;
+    bl->target = clamp(level, 0, LCD_BL_MAX_BRIGHTNESS);
+    bl->fade_start = ktime_get();
+    spin_unlock_irqrestore(&bl->lock, flags);
+
+    hrtimer_start(&bl->pwm_timer, 0, HRTIMER_MODE_REL);
+}
+
+static void lcd1602a_pwm_stop(struct lcd1602a_data *priv)
+{
+    hrtimer_cancel(&priv->bl.pwm_timer);
+    cancel_work_sync(&priv->bl.pwm_work);
+}
+
+static int lcd1602a_bl_update_status(struct backlight_device *bd)
+{
+    struct lcd1602a_data *priv = bl_get_data(bd);
+
+    lcd1602a_set_brightness(priv, backlight_get_brightness(bd));
+    return 0;
+}
+
+static int lcd1602a_bl_get_brightness(struct backlight_device *bd)
+{
+    struct lcd1602a_data *priv = bl_get_data(bd);
+
+    return READ_ONCE(priv->bl.level);
+}
+
+static const struct backlight_ops lcd1602a_bl_ops = {
+    .update_status = lcd1602a_bl_update_status,
+    .get_brightness = lcd1602a_bl_get_brightness,
+};
+
+static int lcd1602a_backlight_register(struct lcd1602a_data *priv)
+{
+    struct backlight_properties props = {
+        .type = BACKLIGHT_RAW,
+        .max_brightness = LCD_BL_MAX_BRIGHTNESS,
+        .brightness = LCD_BL_MAX_BRIGHTNESS,
+        .scale = BACKLIGHT_SCALE_LINEAR,
+    };
+
+    priv->bl.bd = backlight_device_register(dev_name(priv->dev), priv->dev, priv,
+                                            &lcd1602a_bl_ops, &props);
+    if (IS_ERR(priv->bl.bd)) {
+        dev_err(priv->dev, "Error! Could not register backlight device!\n");
+        return PTR_ERR(priv->bl.bd);
+    }
+
+    return 0;
+}
+
+/* On/off switches go through the class device, so its brightness stays in sync */
+static int lcd1602a_backlight_switch(struct lcd1602a_data *priv, bool on)
+{
+    return backlight_device_set_brightness(priv->bl.bd, (on) ? LCD_BL_MAX_BRIGHTNESS : 0);
+}
+
+/***** auxdisplay charlcd backend *****/
+
+#if IS_REACHABLE(CONFIG_HD44780_COMMON)
+
+/* charlcd layer does its own command sequencing and delays, only the
+ * PCF8574 transport is ours: every op is one I2C transaction. */
+static void lcd1602a_hdc_send(struct hd44780_common *hdc, u8 byte, bool not_cmd)
+{
+    struct lcd1602a_data *priv = hdc->hd44780;
+
+    mutex_lock(&priv->bus_lock);
+    if (!lcd1602a_batch_byte(priv, byte, not_cmd))
+        lcd1602a_batch_flush(priv);
+    priv->batch_len = 0;
+    /* Address counter is driven by the charlcd layer */
+    priv->addr_pos = -1;
+    mutex_unlock(&priv->bus_lock);
+}
+
+static void lcd1602a_hdc_write_data(struct hd44780_common *hdc, int data)
+{
+    lcd1602a_hdc_send(hdc, data, 1);
+}
+
+static void lcd1602a_hdc_write_cmd(struct hd44780_common *hdc, int cmd)
+{
+    lcd1602a_hdc_send(hdc, cmd, 0);
+}
+
+static void lcd1602a_hdc_write_cmd_raw4(struct hd44780_common *hdc, int cmd)
+{
+    struct lcd1602a_data *priv = hdc->hd44780;
+
+    mutex_lock(&priv->bus_lock);
+    if (!lcd1602a_batch_nibble(priv, cmd << 4, 0))
+        lcd1602a_batch_flush(priv);
+    priv->batch_len = 0;
+    /* Raw nibbles are sent only while charlcd (re)initializes the LCD */
+    lcd1602a_regs_invalidate(priv);
+    mutex_unlock(&priv->bus_lock);
+}
+
+static void lcd1602a_charlcd_backlight(struct charlcd *lcd, enum charlcd_onoff on)
+{
+    struct hd44780_common *hdc = lcd->drvdata;
+
+    lcd1602a_backlight_switch(hdc->hd44780, on);
+}
+
+static const struct charlcd_ops lcd1602a_charlcd_ops = {
+    .backlight = lcd1602a_charlcd_backlight,
+    .print = hd44780_common_print,
+    .gotoxy = hd44780_common_gotoxy,
+    .home = hd44780_common_home,
+    .clear_display = hd44780_common_clear_display,
+    .init_display = hd44780_common_init_display,
+    .shift_cursor = hd44780_common_shift_cursor,
+    .shift_display = hd44780_common_shift_display,
+    .display = hd44780_common_display,
+    .cursor = hd44780_common_cursor,
+    .blink = hd44780_common_blink,
+    .fontsize = hd44780_common_fontsize,
+    .lines = hd44780_common_lines,
+    .redefine_char = hd44780_common_redefine_char,
+};
+
+static int lcd1602a_charlcd_register(struct lcd1602a_data *priv)
+{
+    int ret;
+    struct charlcd *lcd;
+    struct hd44780_common *hdc;
+
+    hdc = hd44780_common_alloc();
+    if (!hdc)
+        return -ENOMEM;
+
+    lcd = charlcd_alloc();
+    if (!lcd) {
+        ret = -ENOMEM;
+        goto charlcd_err1;
+    }
+
+    hdc->hd44780 = priv;
+    hdc->ifwidth = 4;
+    hdc->write_data = lcd1602a_hdc_write_data;
+    hdc->write_cmd = lcd1602a_hdc_write_cmd;
+    hdc->write_cmd_raw4 = lcd1602a_hdc_write_cmd_raw4;
+
+    lcd->drvdata = hdc;
+    lcd->ops = &lcd1602a_charlcd_ops;
+    lcd->width = LCD_COLS;
+    lcd->height = LCD_ROWS;
+
+    ret = charlcd_register(lcd);
+    if (ret)
+        goto charlcd_err2;
+
+    priv->charlcd = lcd;
+    set_bit(LCD_CHARLCD_FLAG, &priv->state_flags);
+    return 0;
+
+charlcd_err2:
+    charlcd_free(lcd);
+charlcd_err1:
+    kfree(hdc);
+    return ret;
+}
+
+static void lcd1602a_charlcd_unregister(struct lcd1602a_data *priv)
+{
+    struct hd44780_common *hdc;
+
+    if (!priv->charlcd)
+        return;
+
+    hdc = priv->charlcd->drvdata;
+    charlcd_unregister(priv->charlcd);
+    charlcd_free(priv->charlcd);
+    kfree(hdc);
+    priv->charlcd = NULL;
+}
+
+#else
+
+static int lcd1602a_charlcd_register(struct lcd1602a_data *priv)
+{
+    return -EOPNOTSUPP;
+}
+
+static void lcd1602a_charlcd_unregister(struct lcd1602a_data *priv)
+{
+}
+
+#endif /* IS_REACHABLE(CONFIG_HD44780_COMMON) */
+
+/***** Threaded IRQ handler *****/
+
+/* Must be called with priv->bus_lock held */
+static void lcd1602a_toggle_display(struct lcd1602a_data *priv)
+{
+    int ret;
+
+    if (test_bit(LCD_VISIBLE_FLAG, &priv->state_flags)) {
+        ret = lcd1602a_send_cmd(priv, CMD_LCD_DISPLAY_OFF);
+        if (ret)
+            goto lcd_toggle_err;
+        clear_bit(LCD_VISIBLE_FLAG, &priv->state_flags);
+    } else {
+        if (test_bit(LCD_CURSOR_FLAG, &priv->state_flags)) {
+            ret = lcd1602a_send_cmd(priv, CMD_LCD_DISPLAY_CURSOR);
+            if (ret)
+                goto lcd_toggle_err;
+        } else {
+            ret = lcd1602a_send_cmd(priv, CMD_LCD_DISPLAY_PLAIN);
+            if (ret)
+                goto lcd_toggle_err;
+        }
+        set_bit(LCD_VISIBLE_FLAG, &priv->state_flags);
+    }
+
+lcd_toggle_err:
+    return;
+}
+
+/* Button doesn't wait for the bus, the toggle is applied by update_work */
+static void lcd1602a_request_toggle(struct lcd1602a_data *priv)
+{
+    atomic_inc(&priv->toggle_reqs);
+    schedule_work(&priv->update_work);
+}
+
+/* Report press and release of a gesture key */
+static void lcd1602a_report_tap(struct lcd1602a_button *button, unsigned int code)
+{
+    input_report_key(button->input, code, 1);
+    input_sync(button->input);
+    input_report_key(button->input, code, 0);
+    input_sync(button->input);
+}
+
+static void lcd1602a_long_press_timer(struct timer_list *t)
+{
+    struct lcd1602a_button *button = from_timer(button, t, long_timer);
+
+    lcd1602a_report_tap(button, button->long_code);
+}
+
+/* Handle button level change, called only for debounced edges */
+static void lcd1602a_button_event(struct lcd1602a_data *priv)
+{
+    bool pressed;
+    struct lcd1602a_button *button = &priv->button;
+
+    /* Skip bounces which don't change the level */
+    pressed = gpiod_get_value_cansleep(priv->btn) > 0;
+    if (pressed == button->pressed)
+        return;
+
+    button->pressed = pressed;
+    input_report_key(button->input, button->code, pressed);
+    input_sync(button->input);
+
+    if (!pressed) {
+        timer_delete(&button->long_timer);
+        return;
+    }
+
+    if (button->long_code)
+        mod_timer(&button->long_timer, jiffies + button->long_period);
+
+    if (button->double_code) {
+        if (button->double_armed &&
+            time_before(jiffies, button->last_press + button->double_period)) {
+            lcd1602a_report_tap(button, button->double_code);
+            button->double_armed = false;
+        } else {
+            button->last_press = jiffies;
+            button->double_armed = true;
+        }
+    }
+
+    if (button->toggle)
+        lcd1602a_request_toggle(priv);
+}
+
+/* Level is stable for the debounce period */
+static void lcd1602a_debounce_work(struct work_struct *work)
+{
+    u32 latency;
+    struct lcd1602a_data *priv = container_of(work, struct lcd1602a_data, button.debounce_work);
+    struct lcd1602a_button *button = &priv->button;
+
+    lcd1602a_button_event(priv);
+
+    latency = ktime_us_delta(ktime_get(), button->first_edge);
+    WRITE_ONCE(button->latency_last_us, latency);
+    if (latency > button->latency_max_us)
+        WRITE_ONCE(button->latency_max_us, latency);
+}
+
+static enum hrtimer_restart lcd1602a_debounce_timer(struct hrtimer *t)
+{
+    struct lcd1602a_button *button = container_of(t, struct lcd1602a_button, debounce_timer);
+
+    queue_work(system_highpri_wq, &button->debounce_work);
+    return HRTIMER_NORESTART;
+}
+
+static irqreturn_t lcd1602a_isr(int irq, void *dev_id)
+{
+    struct lcd1602a_data *priv = dev_id;
+    struct lcd1602a_button *button = &priv->button;
+
+    if (!test_bit(LCD_NO_DEBOUNCE_FLAG, &priv->state_flags))
+        return IRQ_WAKE_THREAD;
+
+    /* Every edge restarts the debounce period */
+    if (hrtimer_active(&button->debounce_timer))
+        atomic_inc(&button->filtered_edges);
+    else
+        button->first_edge = ktime_get();
+
+    hrtimer_start(&button->debounce_timer, button->debounce, HRTIMER_MODE_REL);
+    return IRQ_HANDLED;
+}
+
+static irqreturn_t lcd1602a_threaded_isr(int irq, void *dev_id)
+{
+    lcd1602a_button_event(dev_id);
+    return IRQ_HANDLED;
+}
+
+static void lcd1602a_button_cleanup(void *data)
+{
+    struct lcd1602a_button *button = data;
+
+    hrtimer_cancel(&button->debounce_timer);
+    cancel_work_sync(&button->debounce_work);
+    timer_delete_sync(&button->long_timer);
+}
+
+static int lcd1602a_button_init(struct lcd1602a_data *priv)
+{
+    int ret;
+    u32 val;
+    struct lcd1602a_button *button = &priv->button;
+
+    button->code = LCD_BTN_DEFAULT_CODE;
+    device_property_read_u32(priv->dev, "linux,code", &button->code);
+    device_property_read_u32(priv->dev, "nkosyrev,long-press-code", &button->long_code);
+    device_property_read_u32(priv->dev, "nkosyrev,double-click-code", &button->double_code);
+    button->toggle = device_property_read_bool(priv->dev, "nkosyrev,toggle-display");
+
+    if (device_property_read_u32(priv->dev, "nkosyrev,long-press-ms", &val))
+        val = LCD_BTN_LONG_PRESS_MS;
+    button->long_period = msecs_to_jiffies(val);
+
+    if (device_property_read_u32(priv->dev, "nkosyrev,double-click-ms", &val))
+        val = LCD_BTN_DOUBLE_CLICK_MS;
+    button->double_period = msecs_to_jiffies(val);
+
+    if (button->code > KEY_MAX || button->long_code > KEY_MAX || button->double_code > KEY_MAX) {
+        dev_err(priv->dev, "Error! Invalid button key code!\n");
+        return -EINVAL;
+    }
+
+    button->input = devm_input_allocate_device(priv->dev);
+    if (!button->input) {
+        dev_err(priv->dev, "Error! Could not allocate input device!\n");
+        return -ENOMEM;
+    }
+
+    button->input->name = LCD_MODULE_NAME " button";
+    button->input->phys = LCD_MODULE_NAME "/input0";
+    button->input->id.bustype = BUS_HOST;
+
+    input_set_capability(button->input, EV_KEY, button->code);
+    if (button->long_code)
+        input_set_capability(button->input, EV_KEY, button->long_code);
+    if (button->double_code)
+        input_set_capability(button->input, EV_KEY, button->double_code);
+
+    ret = input_register_device(button->input);
+    if (ret) {
+        dev_err(priv->dev, "Error! Could not register input device! (code = %d)\n", ret);
+        return ret;
+    }
+
+    /* Timers must be stopped after IRQ is freed, so register cleanup before it */
+    timer_setup(&button->long_timer, lcd1602a_long_press_timer, 0);
+    hrtimer_init(&button->debounce_timer, CLOCK_MONOTONIC, HRTIMER_MODE_REL);
+    button->debounce_timer.function = lcd1602a_debounce_timer;
+    INIT_WORK(&button->debounce_work, lcd1602a_debounce_work);
+    ret = devm_add_action_or_reset(priv->dev, lcd1602a_button_cleanup, button);
+    if (ret)
+        return ret;
+
+    ret = devm_request_threaded_irq(priv->dev, priv->irq, lcd1602a_isr, lcd1602a_threaded_isr,
+                                    IRQF_ONESHOT | IRQF_TRIGGER_FALLING | IRQF_TRIGGER_RISING,
+                                    LCD_MODULE_NAME, priv);
+    if (ret) {
+        dev_err(priv->dev, "Error! Could request IRQ handler! (code = %d)\n", ret);
+        return ret;
+    }
+
+    return 0;
+}
+
+/***** File operation methods *****/
+
+/* Open files and in-kernel handles keep priv alive after remove() */
+static void lcd1602a_free(struct kref *ref)
+{
+    struct lcd1602a_data *priv = container_of(ref, struct lcd1602a_data, ref);
+    struct lcd1602a_snapshot *snap = rcu_dereference_protected(priv->snap, 1);
+
+    /* Nobody can read the last snapshot since now */
+    if (snap && !snap->pooled)
+        kfree_rcu(snap, rcu);
+    kfree(priv);
+}
+
+/* Reference of probe() is dropped by devm after remove() */
+static void lcd1602a_put_data(void *data)
+{
+    struct lcd1602a_data *priv = data;
+
+    kref_put(&priv->ref, lcd1602a_free);
+}
+
+/* Convert file position inside @rgn into the @screen's virtual file position */
+static loff_t lcd1602a_rgn_to_screen(const struct lcd_region *screen, const struct lcd_region *rgn, loff_t pos)
+{
+    int row_size = lcd1602a_rgn_row_size(rgn);
+
+    if (pos >= lcd1602a_rgn_write_size(rgn))
+        return lcd1602a_rgn_write_size(screen);
+
+    return (rgn->row + pos / row_size) * lcd1602a_rgn_row_size(screen) + rgn->col + pos % row_size;
+}
+
+static bool lcd1602a_client_covers(const struct lcd1602a_client *client, int row, int col)
+{
+    const struct lcd_region *rgn = &client->region;
+
+    return row >= rgn->row && row < rgn->row + rgn->rows &&
+           col >= rgn->col && col < rgn->col + rgn->cols;
+}
+
+/* Must be called with priv->bus_lock held. Returns the client which owns the
+ * cell: the highest priority among active ones, the latest update wins a tie.
+ * Any cell is taken into account when @row is negative. */
+static struct lcd1602a_client *lcd1602a_top_client(struct lcd1602a_data *priv, int row, int col)
+{
+    struct lcd1602a_client *client, *top = NULL;
+
+    list_for_each_entry(client, &priv->clients, node) {
+        if (!client->active)
+            continue;
+
+        if (row >= 0 && !lcd1602a_client_covers(client, row, col))
+            continue;
+
+        if (!top || client->priority > top->priority ||
+            (client->priority == top->priority && client->stamp > top->stamp))
+            top = client;
+    }
+
+    return top;
+}
+
+/* Must be called with priv->bus_lock held. Merge clients' regions by priority
+ * under the overlay and send the result as one frame. Cells which nobody has
+ * drawn keep the last content. LCD's cursor follows the top client. */
+static int lcd1602a_compose(struct lcd1602a_data *priv)
+{
+    int row, col;
+    loff_t cursor_pos = priv->cursor_pos;
+    struct lcd1602a_overlay *ovl = &priv->overlay;
+    struct lcd1602a_client *top = lcd1602a_top_client(priv, -1, -1);
+
+    if (top)
+        cursor_pos = top->cursor_pos;
+
+    for (row = 0; row < LCD_ROWS; row++) {
+        for (col = 0; col < priv->screen.cols; col++) {
+            top = lcd1602a_top_client(priv, row, col);
+            if (top)
+                priv->base[row][col] = top->cells[row][col];
+        }
+    }
+
+    memcpy(priv->back, priv->base, sizeof(priv->back));
+
+    if (ovl->active) {
+        for (row = 0; row < LCD_ROWS; row++)
+            for (col = 0; col < priv->screen.cols; col++)
+                if (ovl->mask[row][col])
+                    priv->back[row][col] = ovl->cells[row][col];
+    }
+
+    return lcd1602a_request_commit(priv, cursor_pos);
+}
+
+/* Overlay is over, only the cells it covered differ from the base content */
+static void lcd1602a_overlay_expire(struct work_struct *work)
+{
+    struct lcd1602a_data *priv = container_of(to_delayed_work(work), struct lcd1602a_data, overlay.expire_work);
+
+    mutex_lock(&priv->bus_lock);
+    /* Not re-armed by a newer overlay while we were waiting for the lock */
+    if (!delayed_work_pending(&priv->overlay.expire_work)) {
+        priv->overlay.active = false;
+        if (!priv->removed)
+            lcd1602a_compose(priv);
+    }
+    mutex_unlock(&priv->bus_lock);
+
+    wake_up_interruptible(&priv->wqueue_wait);
+}
+
+/* Buffer which takes the client's writes */
+static inline u8 (*lcd1602a_client_buf(struct lcd1602a_client *client))[DDRAM_ROW_LENGTH]
+{
+    return (client->composing) ? client->frame : client->cells;
+}
+
+/* Must be called with priv->bus_lock held after the client's buffer is
+ * changed. Returns true if the screen has to be composed again. */
+static bool lcd1602a_client_touch(struct lcd1602a_client *client, loff_t cursor_pos)
+{
+    /* Frame is going to be shown later by LCD_IOC_FRAME_COMMIT */
+    if (client->composing)
+        return false;
+
+    client->cursor_pos = lcd1602a_rgn_to_screen(&client->priv->screen, &client->region, cursor_pos);
+    client->stamp = ++client->priv->stamp;
+    client->active = true;
+    return true;
+}
+
+/* Must be called with priv->bus_lock held. Client starts drawing over the
+ * current screen, nothing is shown until its first write. */
+static void lcd1602a_client_init(struct lcd1602a_data *priv, struct lcd1602a_client *client)
+{
+    client->priv = priv;
+    client->priority = LCD_PRIORITY_DEFAULT;
+    client->region = priv->screen;
+    memcpy(client->cells, priv->base, sizeof(client->cells));
+    list_add_tail(&client->node, &priv->clients);
+}
+
+/* Open files hold the cdev, not priv. Device looked up by the cdev gets a
+ * reference unless it has been removed or isn't probed completely. */
+static struct lcd1602a_data *lcd1602a_find_by_cdev(struct cdev *cdev)
+{
+    struct lcd1602a_data *iter, *priv = NULL;
+
+    mutex_lock(&lcd1602a_devices_lock);
+    list_for_each_entry(iter, &lcd1602a_devices, node) {
+        if (iter->cdev == cdev) {
+            priv = iter;
+            kref_get(&priv->ref);
+            break;
+        }
+    }
+    mutex_unlock(&lcd1602a_devices_lock);
+
+    return priv;
+}
+
+static loff_t lcd1602_llseek(struct file *file, loff_t offset, int orig)
+{
+    struct lcd1602a_client *client = file->private_data;
+    struct lcd_region rgn = client->region;
+
+    return fixed_size_llseek(file, offset, orig, rgn.rows * lcd1602a_rgn_row_size(&rgn));
+}
+
+static int lcd1602a_open(struct inode *inode, struct file *filp)
+{
+    int ret = -EFAULT;
+    struct lcd1602a_client *client;
+    struct lcd1602a_data *priv = lcd1602a_find_by_cdev(inode->i_cdev);
+
+    if (!priv)
+        return -ENODEV;
+
+    if (!test_bit(LCD_VISIBLE_FLAG, &priv->state_flags)) {
+        ret = -EIO;
+        goto open_put;
+    }
+
+    /* Content is owned by charlcd layer (/dev/lcd misc device) */
+    if (test_bit(LCD_CHARLCD_FLAG, &priv->state_flags)) {
+        ret = -EBUSY;
+        goto open_put;
+    }
+
+    client = kzalloc(sizeof(*client), GFP_KERNEL);
+    if (!client) {
+        ret = -ENOMEM;
+        goto open_put;
+    }
+
+    filp->private_data = client;
+    filp->f_pos = 0;
+
+    /* Writes queued before are a part of the initial content */
+    flush_work(&priv->update_work);
+
+    mutex_lock(&priv->bus_lock);
+
+    /* Device has been removed after the lookup */
+    if (priv->removed) {
+        ret = -ENODEV;
+        goto open_err;
+    }
+
+    /* Address counter is read back only if it is unknown after an error.
+     * It doesn't point to DDRAM after glyph loading, cursor is used then. */
+    if ((filp->f_flags & O_APPEND) && priv->addr_pos < 0 && !priv->regs.cgram) {
+        ret = lcd1602a_get_current_address(priv);
+        if (ret < 0)
+            goto open_err;
+
+        if (ret >= DDRAM_1ROW_OFFSET &&
+            ret < DDRAM_1ROW_OFFSET + DDRAM_ROW_LENGTH)
+            priv->addr_pos = ret - DDRAM_1ROW_OFFSET;
+        else if (ret >= DDRAM_2ROW_OFFSET &&
+                 ret < DDRAM_2ROW_OFFSET + DDRAM_ROW_LENGTH)
+            priv->addr_pos = (ret - DDRAM_2ROW_OFFSET) + LCD_VIRT_ROW_SIZE;
+    }
+
+    lcd1602a_client_init(priv, client);
+
+    if (filp->f_flags & O_TRUNC) {
+        memset(client->cells, ' ', sizeof(client->cells));
+        lcd1602a_client_touch(client, 0);
+    }
+
+    if ((filp->f_flags & O_APPEND) && priv->addr_pos >= 0)
+        filp->f_pos = lcd1602a_ddram_to_pos(priv, priv->addr_pos);
+    else if (filp->f_flags & O_APPEND)
+        filp->f_pos = min_t(loff_t, priv->cursor_pos, lcd1602a_rgn_write_size(&priv->screen));
+
+    ret = lcd1602a_compose(priv);
+    if (ret) {
+        list_del(&client->node);
+        goto open_err;
+    }
+
+    mutex_unlock(&priv->bus_lock);
+    return ret;
+
+open_err:
+    mutex_unlock(&priv->bus_lock);
+    kfree(client);
+open_put:
+    kref_put(&priv->ref, lcd1602a_free);
+    return ret;
+}
+
+static int lcd1602a_release(struct inode *inode, struct file *filp)
+{
+    int i;
+    struct lcd1602a_client *client = filp->private_data;
+    struct lcd1602a_data *priv = client->priv;
+
+    /* Queued records point to the client */
+    flush_work(&priv->update_work);
+
+    /* Uncommitted frame is dropped, lower priority content shows up */
+    mutex_lock(&priv->bus_lock);
+    for (i = 0; i < LCD_WIDGETS_MAX; i++)
+        if (client->widgets[i].type)
+            lcd1602a_glyphs_put(priv);
+    if (client->clock.format[0])
+        priv->clocks--;
+    list_del(&client->node);
+    if (client->active && !priv->removed)
+        lcd1602a_compose(priv);
+    mutex_unlock(&priv->bus_lock);
+
+    kfree(client);
+    kref_put(&priv->ref, lcd1602a_free);
+    return 0;
+}
+
+/* Served from the published snapshot, so readers never wait for a transfer in flight */
+static ssize_t lcd1602a_read(struct file *filp, char __user *buf, size_t count, loff_t *ppos)
+{
+    int i = 0;
+    unsigned char tmp[LCD_VIRT_ROW_SIZE];
+    struct lcd1602a_snapshot snap;
+    struct lcd1602a_client *client = filp->private_data;
+    struct lcd1602a_data *priv = client->priv;
+    struct lcd_region rgn = client->region;
+
+    /* We are going to read by rows of the region. The last char of a row is always '\n'. */
+    int virt_row_size = lcd1602a_rgn_row_size(&rgn);
+    loff_t virt_pos = *ppos;
+    loff_t rel_virt_pos = virt_pos % virt_row_size;
+    int row = rgn.row + virt_pos / virt_row_size;
+
+    if (!test_bit(LCD_VISIBLE_FLAG, &priv->state_flags))
+        return -EIO;
+
+    /* Handle zero count or EOF */
+    if (!count || (*ppos >= rgn.rows * virt_row_size))
+        return 0;
+
+    if (count > virt_row_size - rel_virt_pos)
+        count = virt_row_size - rel_virt_pos;
+
+    /* Queued writes are not on the screen yet */
+    if (filp->f_flags & O_NONBLOCK) {
+        if (atomic_read(&priv->nr_updates))
+            return -EAGAIN;
+    } else {
+        flush_work(&priv->update_work);
+    }
+
+    lcd1602a_snapshot_read(priv, &snap);
+
+    for (i = 0; i < count; i++) {
+        /* Check 'new line' position */
+        if (rel_virt_pos + i == rgn.cols)
+            tmp[i] = '\n';
+        else
+            tmp[i] = snap.cells[row][rgn.col + rel_virt_pos + i];
+    }
+
+    if (copy_to_user(buf, tmp, count))
+        return -EFAULT;
+
+    *ppos = virt_pos + count;
+    return count;
+}
+
+/* Calculate file position after writing @ch at @virt_pos (see lcd1602a_render()) */
+static loff_t lcd1602a_next_pos(loff_t virt_pos, u8 ch, int row_size)
+{
+    int rel_virt_pos = virt_pos % row_size;
+
+    if (rel_virt_pos == row_size - 1) {
+        virt_pos++;
+        if (ch == '\n')
+            return virt_pos;
+        rel_virt_pos = 0;
+    }
+
+    if (ch == '\n')
+        return virt_pos - rel_virt_pos + row_size;
+
+    return virt_pos + 1;
+}
+
+/* Render @count bytes of @buf into @rgn of @cells starting at virtual file
+ * position *ppos inside the region. Changed cells are marked in @mask unless
+ * it is NULL. Returns number of consumed bytes. */
+static size_t lcd1602a_render(u8 cells[][DDRAM_ROW_LENGTH], u8 mask[][DDRAM_ROW_LENGTH],
+                              const struct lcd_region *rgn, const u8 *buf, size_t count, loff_t *ppos)
+{
+    size_t i;
+    int row, col;
+    int row_size = lcd1602a_rgn_row_size(rgn);
+    loff_t virt_pos = *ppos;
+
+    for (i = 0; i < count && virt_pos < lcd1602a_rgn_write_size(rgn); i++) {
+        row = rgn->row + virt_pos / row_size;
+        col = virt_pos % row_size;
+
+        if (col == rgn->cols) {
+            /* '\n' as the last char of a row is skipped, any other char goes to the next row */
+            if (buf[i] != '\n') {
+                cells[row + 1][rgn->col] = buf[i];
+                if (mask)
+                    mask[row + 1][rgn->col] = 1;
+            }
+        } else if (buf[i] == '\n') {
+            /* '\n' before the end of a row. Fill the rest of the row with spaces. */
+            memset(&cells[row][rgn->col + col], ' ', rgn->cols - col);
+            if (mask)
+                memset(&mask[row][rgn->col + col], 1, rgn->cols - col);
+        } else {
+            cells[row][rgn->col + col] = buf[i];
+            if (mask)
+                mask[row][rgn->col + col] = 1;
+        }
+
+        virt_pos = lcd1602a_next_pos(virt_pos, buf[i], row_size);
+    }
+
+    *ppos = virt_pos;
+    return i;
+}
+
+/* Must be called with priv->bus_lock held */
+static int lcd1602a_overlay_set(struct lcd1602a_data *priv, const struct lcd_overlay *req)
+{
+    loff_t pos = req->pos;
+    struct lcd1602a_overlay *ovl = &priv->overlay;
+
+    if (req->timeout_ms) {
+        if (req->pos >= lcd1602a_rgn_write_size(&priv->screen) || req->len > LCD_OP_DATA_SIZE)
+            return -EINVAL;
+
+        /* New overlay replaces the previous one */
+        memset(ovl->mask, 0, sizeof(ovl->mask));
+        lcd1602a_render(ovl->cells, ovl->mask, &priv->screen, req->data, req->len, &pos);
+        ovl->active = true;
+        mod_delayed_work(system_wq, &ovl->expire_work, msecs_to_jiffies(req->timeout_ms));
+    } else {
+        ovl->active = false;
+        cancel_delayed_work(&ovl->expire_work);
+    }
+
+    return lcd1602a_compose(priv);
+}
+
+/* Cell of a bar filled by @fill steps, empty and full cells are ROM chars */
+static u8 lcd1602a_bar_cell(unsigned int fill, u8 first_glyph)
+{
+    if (!fill)
+        return ' ';
+    if (fill >= LCD_BAR_STEPS)
+        return LCD_CHAR_FULL_BLOCK;
+
+    return first_glyph + fill - 1;
+}
+
+/* Draw a bar or a progress bar with @w's top left cell at @row, @col of @cells */
+static void lcd1602a_draw_bar(u8 cells[][DDRAM_ROW_LENGTH], const struct lcd_widget *w,
+                              unsigned int row, unsigned int col)
+{
+    int i, step;
+    char text[LCD_PROGRESS_TEXT_LEN + 1];
+    unsigned int value = min(w->value, w->max);
+    unsigned int fill = div_u64((u64)value * w->len * LCD_BAR_STEPS, w->max);
+    u8 first_glyph = (w->type == LCD_WIDGET_VBAR) ? LCD_VBAR_FIRST_GLYPH : LCD_HBAR_FIRST_GLYPH;
+
+    for (i = 0; i < w->len; i++) {
+        step = clamp_val((int)fill - i * LCD_BAR_STEPS, 0, LCD_BAR_STEPS);
+        if (w->type == LCD_WIDGET_VBAR)
+            cells[row + w->len - 1 - i][col] = lcd1602a_bar_cell(step, first_glyph);
+        else
+            cells[row][col + i] = lcd1602a_bar_cell(step, first_glyph);
+    }
+
+    if (w->type == LCD_WIDGET_PROGRESS) {
+        snprintf(text, sizeof(text), "%3u%%", (unsigned int)div_u64((u64)value * 100, w->max));
+        memcpy(&cells[row][col + w->len], text, LCD_PROGRESS_TEXT_LEN);
+    }
+}
+
+/* Draw @w's value right aligned over both rows from column @col. Leading
+ * zeros are blank, a value which doesn't fit is shown as dashes. */
+static void lcd1602a_draw_big_number(u8 cells[][DDRAM_ROW_LENGTH], const struct lcd_widget *w,
+                                     unsigned int col)
+{
+    int i, row;
+    unsigned int digit, value = w->value;
+    unsigned int digits[LCD_WIDGET_DIGITS_MAX];
+
+    for (i = w->len - 1; i >= 0; i--) {
+        digits[i] = (value || i == w->len - 1) ? value % 10 : LCD_BIG_BLANK;
+        value /= 10;
+    }
+
+    for (i = 0; i < w->len; i++) {
+        digit = (value) ? LCD_BIG_MINUS : digits[i];
+        for (row = 0; row < LCD_ROWS; row++) {
+            memcpy(&cells[row][col + i * LCD_BIG_DIGIT_PITCH], lcd1602a_big_digits[digit][row],
+                   LCD_BIG_DIGIT_COLS);
+            if (i < w->len - 1)
+                cells[row][col + i * LCD_BIG_DIGIT_PITCH + LCD_BIG_DIGIT_COLS] = ' ';
+        }
+    }
+}
+
+/* Cells taken by the widget in a row (or in a column for a vertical bar) */
+static unsigned int lcd1602a_widget_size(const struct lcd_widget *w)
+{
+    switch (w->type) {
+    case LCD_WIDGET_HBAR:
+    case LCD_WIDGET_VBAR:
+        return w->len;
+    case LCD_WIDGET_PROGRESS:
+        return w->len + LCD_PROGRESS_TEXT_LEN;
+    case LCD_WIDGET_BIG_NUMBER:
+        return w->len * LCD_BIG_DIGIT_PITCH - 1;
+    default:
+        return 0;
+    }
+}
+
+static int lcd1602a_widget_glyphs(u8 type)
+{
+    return (type == LCD_WIDGET_BIG_NUMBER) ? LCD_GLYPHS_BIG_DIGITS : LCD_GLYPHS_BARS;
+}
+
+/* Widget @w has to fit into @rgn */
+static int lcd1602a_widget_check(const struct lcd_widget *w, const struct lcd_region *rgn)
+{
+    unsigned int size = lcd1602a_widget_size(w);
+
+    if (!size || !w->len || w->row >= rgn->rows || w->col >= rgn->cols)
+        return -EINVAL;
+
+    switch (w->type) {
+    case LCD_WIDGET_VBAR:
+        if (!w->max || w->row + size > rgn->rows)
+            return -EINVAL;
+        break;
+    case LCD_WIDGET_BIG_NUMBER:
+        /* Digits take both rows of the screen */
+        if (w->len > LCD_WIDGET_DIGITS_MAX || rgn->rows != LCD_ROWS || w->col + size > rgn->cols)
+            return -EINVAL;
+        break;
+    default:
+        if (!w->max || w->col + size > rgn->cols)
+            return -EINVAL;
+    }
+
+    return 0;
+}
+
+/* Must be called with priv->bus_lock held */
+static void lcd1602a_widget_drop(struct lcd1602a_client *client, unsigned int id)
+{
+    if (client->widgets[id].type)
+        lcd1602a_glyphs_put(client->priv);
+    client->widgets[id].type = LCD_WIDGET_NONE;
+}
+
+/* Must be called with priv->bus_lock held. Widget is drawn into the client's
+ * buffer like a write, so the frame commit sends only the cells which have
+ * changed: the boundary cell and the cells which crossed a step of a bar,
+ * the columns of changed digits of a big number. */
+static int lcd1602a_widget_set(struct lcd1602a_client *client, const struct lcd_widget *w, loff_t cursor_pos)
+{
+    int ret;
+    u8 old;
+    struct lcd_region *rgn = &client->region;
+    struct lcd1602a_data *priv = client->priv;
+    u8 (*cells)[DDRAM_ROW_LENGTH] = lcd1602a_client_buf(client);
+
+    if (w->id >= LCD_WIDGETS_MAX)
+        return -EINVAL;
+
+    old = client->widgets[w->id].type;
+    if (w->type == LCD_WIDGET_NONE) {
+        lcd1602a_widget_drop(client, w->id);
+        return 0;
+    }
+
+    ret = lcd1602a_widget_check(w, rgn);
+    if (ret)
+        return ret;
+
+    /* Widget of this id may change to one drawn by other glyphs */
+    if (!old || lcd1602a_widget_glyphs(old) != lcd1602a_widget_glyphs(w->type)) {
+        lcd1602a_widget_drop(client, w->id);
+
+        ret = lcd1602a_glyphs_get(priv, lcd1602a_widget_glyphs(w->type));
+        if (ret)
+            return ret;
+    }
+    client->widgets[w->id] = *w;
+
+    if (w->type == LCD_WIDGET_BIG_NUMBER)
+        lcd1602a_draw_big_number(cells, w, rgn->col + w->col);
+    else
+        lcd1602a_draw_bar(cells, w, rgn->row + w->row, rgn->col + w->col);
+
+    if (lcd1602a_client_touch(client, cursor_pos))
+        return lcd1602a_compose(priv);
+
+    return 0;
+}
+
+/* Format @tm by the subset of strftime() documented for struct lcd_clock */
+static void lcd1602a_clock_format(char *buf, size_t size, const char *fmt, const struct tm *tm)
+{
+    size_t len = 0;
+
+    for (; *fmt && len < size - 1; fmt++) {
+        if (*fmt != '%' || !fmt[1]) {
+            buf[len++] = *fmt;
+            continue;
+        }
+
+        switch (*++fmt) {
+        case 'H':
+            len += scnprintf(buf + len, size - len, "%02d", tm->tm_hour);
+            break;
+        case 'M':
+            len += scnprintf(buf + len, size - len, "%02d", tm->tm_min);
+            break;
+        case 'S':
+            len += scnprintf(buf + len, size - len, "%02d", tm->tm_sec);
+            break;
+        case 'd':
+            len += scnprintf(buf + len, size - len, "%02d", tm->tm_mday);
+            break;
+        case 'm':
+            len += scnprintf(buf + len, size - len, "%02d", tm->tm_mon + 1);
+            break;
+        case 'y':
+            len += scnprintf(buf + len, size - len, "%02ld", (tm->tm_year + 1900) % 100);
+            break;
+        case 'Y':
+            len += scnprintf(buf + len, size - len, "%04ld", tm->tm_year + 1900);
+            break;
+        default:
+            buf[len++] = *fmt;
+        }
+    }
+
+    buf[len] = '\0';
+}
+
+/* Must be called with priv->bus_lock held. Draw the client's clock into its
+ * shown content, the frame commit then sends only the chars which changed. */
+static void lcd1602a_clock_draw(struct lcd1602a_client *client, const struct tm *wall, const struct tm *uptime)
+{
+    char text[LCD_CLOCK_FORMAT_SIZE * 2];
+    const struct lcd_region *rgn = &client->region;
+    const struct lcd_clock *clk = &client->clock;
+    int row = (int)rgn->row + clk->row;
+    int cols = (int)rgn->cols - clk->col;
+
+    /* Region may have shrunk under the clock */
+    if (clk->row >= rgn->rows || row >= LCD_ROWS || cols <= 0)
+        return;
+
+    lcd1602a_clock_format(text, sizeof(text), clk->format,
+                          (clk->flags & LCD_CLOCK_UPTIME) ? uptime : wall);
+
+    memcpy(&client->cells[row][rgn->col + clk->col], text, min_t(int, strlen(text), cols));
+}
+
+static void lcd1602a_clock_now(struct tm *wall, struct tm *uptime)
+{
+    s64 up = ktime_get_boottime_seconds();
+
+    time64_to_tm(ktime_get_real_seconds(), -sys_tz.tz_minuteswest * 60, wall);
+
+    memset(uptime, 0, sizeof(*uptime));
+    uptime->tm_sec = up % 60;
+    uptime->tm_min = up / 60 % 60;
+    uptime->tm_hour = up / 3600 % 24;
+    uptime->tm_mday = up / 86400;
+    uptime->tm_mon = -1;
+    uptime->tm_year = -1900;
+}
+
+/* Next tick comes right after the next second boundary of the wall clock */
+static void lcd1602a_clock_schedule(struct lcd1602a_data *priv)
+{
+    struct timespec64 now;
+
+    ktime_get_real_ts64(&now);
+    mod_delayed_work(system_wq, &priv->clock_work,
+                     usecs_to_jiffies((NSEC_PER_SEC - now.tv_nsec) / NSEC_PER_USEC + 1));
+}
+
+static void lcd1602a_clock_work(struct work_struct *work)
+{
+    struct tm wall, uptime;
+    struct lcd1602a_client *client;
+    struct lcd1602a_data *priv = container_of(to_delayed_work(work), struct lcd1602a_data, clock_work);
+
+    mutex_lock(&priv->bus_lock);
+    /* Last clock or the LCD has been removed */
+    if (!priv->clocks || priv->removed) {
+        mutex_unlock(&priv->bus_lock);
+        return;
+    }
+
+    lcd1602a_clock_now(&wall, &uptime);
+    list_for_each_entry(client, &priv->clients, node)
+        if (client->clock.format[0])
+            lcd1602a_clock_draw(client, &wall, &uptime);
+
+    lcd1602a_compose(priv);
+    lcd1602a_clock_schedule(priv);
+    mutex_unlock(&priv->bus_lock);
+
+    wake_up_interruptible(&priv->wqueue_wait);
+}
+
+/* Must be called with priv->bus_lock held */
+static int lcd1602a_clock_set(struct lcd1602a_client *client, struct lcd_clock *clk, loff_t cursor_pos)
+{
+    struct tm wall, uptime;
+    struct lcd1602a_data *priv = client->priv;
+    bool was_on = client->clock.format[0];
+
+    clk->format[LCD_CLOCK_FORMAT_SIZE - 1] = '\0';
+
+    if (!clk->format[0]) {
+        if (was_on)
+            priv->clocks--;
+        client->clock.format[0] = '\0';
+        return 0;
+    }
+
+    if (clk->row >= client->region.rows || clk->col >= client->region.cols ||
+        (clk->flags & ~LCD_CLOCK_UPTIME))
+        return -EINVAL;
+
+    client->clock = *clk;
+    if (!was_on)
+        priv->clocks++;
+
+    lcd1602a_clock_now(&wall, &uptime);
+    lcd1602a_clock_draw(client, &wall, &uptime);
+    lcd1602a_clock_schedule(priv);
+
+    if (lcd1602a_client_touch(client, cursor_pos))
+        return lcd1602a_compose(priv);
+
+    return 0;
+}
+
+/* Parse @tmpl into @fields and draw its text into @cells. Rows are separated
+ * by '\n', fields are "{name:width}" and start blank. Returns number of fields,
+ * *@rows takes the number of rows used by the template. */
+static int lcd1602a_template_parse(const struct lcd_region *screen, const char *tmpl,
+                                   struct lcd1602a_field *fields, u8 cells[][DDRAM_ROW_LENGTH],
+                                   int *rows)
+{
+    int len, width, n;
+    int nr_fields = 0;
+    int row = 0, col = 0;
+    const char *end;
+    struct lcd1602a_field *field;
+
+    memset(cells, ' ', LCD_ROWS * DDRAM_ROW_LENGTH);
+
+    while (*tmpl) {
+        if (*tmpl == '\n') {
+            if (++row >= screen->rows)
+                return -EINVAL;
+            col = 0;
+            tmpl++;
+            continue;
+        }
+
+        if (*tmpl != '{') {
+            if (col >= screen->cols)
+                return -EINVAL;
+            cells[row][col++] = *tmpl++;
+            continue;
+        }
+
+        end = strchr(++tmpl, '}');
+        len = strcspn(tmpl, ":}");
+        if (!end || tmpl + len == end || !len || len >= LCD_FIELD_NAME_LEN ||
+            nr_fields == LCD_FIELDS_MAX)
+            return -EINVAL;
+
+        if (sscanf(tmpl + len, ":%d%n", &width, &n) != 1 || tmpl + len + n != end ||
+            width <= 0 || width > screen->cols - col)
+            return -EINVAL;
+
+        field = &fields[nr_fields++];
+        memcpy(field->name, tmpl, len);
+        field->name[len] = '\0';
+        field->row = row;
+        field->col = col;
+        field->width = width;
+
+        col += width;
+        tmpl = end + 1;
+    }
+
+    *rows = row + 1;
+    return nr_fields;
+}
+
+static struct lcd1602a_field *lcd1602a_field_find(struct lcd1602a_status *st, const char *name, size_t len)
+{
+    int i;
+
+    for (i = 0; i < st->nr_fields; i++)
+        if (strlen(st->fields[i].name) == len && !strncmp(st->fields[i].name, name, len))
+            return &st->fields[i];
+
+    return NULL;
+}
+
+/* Must be called with priv->bus_lock held. Empty @tmpl removes the status line. */
+static int lcd1602a_template_set(struct lcd1602a_data *priv, const char *tmpl)
+{
+    int ret, rows;
+    u8 cells[LCD_ROWS][DDRAM_ROW_LENGTH];
+    struct lcd1602a_field fields[LCD_FIELDS_MAX];
+    struct lcd1602a_status *st = &priv->status;
+    struct lcd1602a_client *client = &st->client;
+    bool was_set = st->tmpl[0];
+
+    if (!*tmpl) {
+        st->tmpl[0] = '\0';
+        st->nr_fields = 0;
+        if (!was_set)
+            return 0;
+        list_del(&client->node);
+        return lcd1602a_compose(priv);
+    }
+
+    /* Previous template stays shown if the new one is wrong */
+    ret = lcd1602a_template_parse(&priv->screen, tmpl, fields, cells, &rows);
+    if (ret < 0)
+        return ret;
+
+    strscpy(st->tmpl, tmpl, sizeof(st->tmpl));
+    memcpy(st->fields, fields, sizeof(st->fields));
+    memcpy(client->cells, cells, sizeof(client->cells));
+    st->nr_fields = ret;
+
+    /* Rows below the template stay with the other clients */
+    client->region = priv->screen;
+    client->region.rows = rows;
+    if (!was_set)
+        list_add_tail(&client->node, &priv->clients);
+
+    lcd1602a_client_touch(client, lcd1602a_rgn_write_size(&client->region));
+    return lcd1602a_compose(priv);
+}
+
+/* Must be called with priv->bus_lock held. Value is right-aligned in the
+ * field, only the field's cells change, so only they reach the LCD. */
+static int lcd1602a_field_set(struct lcd1602a_data *priv, const char *name, size_t name_len,
+                              const char *value, size_t len)
+{
+    u8 *cells;
+    struct lcd1602a_client *client = &priv->status.client;
+    struct lcd1602a_field *field = lcd1602a_field_find(&priv->status, name, name_len);
+
+    if (!field)
+        return -ENOENT;
+
+    if (len > field->width)
+        return -EOVERFLOW;
+
+    cells = &client->cells[field->row][field->col];
+    memset(cells, ' ', field->width - len);
+    memcpy(cells + field->width - len, value, len);
+
+    lcd1602a_client_touch(client, lcd1602a_rgn_write_size(&client->region));
+    return lcd1602a_compose(priv);
+}
+
+/* Send the frame deferred by the refresh rate limit */
+static void lcd1602a_commit_work(struct work_struct *work)
+{
+    struct lcd1602a_data *priv = container_of(to_delayed_work(work), struct lcd1602a_data, commit_work);
+
+    mutex_lock(&priv->bus_lock);
+    if (test_and_clear_bit(LCD_COMMIT_PENDING_FLAG, &priv->state_flags) && !priv->removed)
+        lcd1602a_commit(priv, priv->cursor_pos);
+    mutex_unlock(&priv->bus_lock);
+
+    wake_up_interruptible(&priv->wqueue_wait);
+}
+
+static bool lcd1602a_is_committed(struct lcd1602a_data *priv)
+{
+    return !atomic_read(&priv->nr_updates) &&
+           !test_bit(LCD_COMMIT_PENDING_FLAG, &priv->state_flags);
+}
+
+/* Lock the device when there are no queued writes and no deferred frame
+ * in the back buffer */
+static int lcd1602a_lock_committed(struct lcd1602a_data *priv, bool nonblock)
+{
+    int ret;
+
+    for (;;) {
+        if (nonblock && !lcd1602a_is_committed(priv))
+            return -EAGAIN;
+
+        ret = wait_event_interruptible(priv->wqueue_wait, lcd1602a_is_committed(priv));
+        if (ret)
+            return ret;
+
+        mutex_lock(&priv->bus_lock);
+        if (lcd1602a_is_committed(priv))
+            return 0;
+        mutex_unlock(&priv->bus_lock);
+    }
+}
+
+/* Records live in priv, a free slot is claimed by its bit in updates_used */
+static struct lcd1602a_update *lcd1602a_update_get(struct lcd1602a_data *priv)
+{
+    int i;
+
+    for (i = 0; i < LCD_UPDATES_MAX; i++)
+        if (!test_and_set_bit_lock(i, &priv->updates_used))
+            return &priv->update_pool[i];
+
+    return NULL;
+}
+
+static void lcd1602a_update_put(struct lcd1602a_data *priv, struct lcd1602a_update *upd)
+{
+    clear_bit_unlock(upd - priv->update_pool, &priv->updates_used);
+}
+
+/* The only bus owner for writes. Everything queued since the last run is
+ * rendered into clients' buffers and the result is sent as one frame. */
+static void lcd1602a_update_work(struct work_struct *work)
+{
+    int ret = 0;
+    int toggles;
+    loff_t pos;
+    bool compose = false;
+    struct llist_node *list;
+    struct lcd1602a_update *upd, *next;
+    struct lcd1602a_client *client;
+    struct lcd1602a_data *priv = container_of(work, struct lcd1602a_data, update_work);
+
+    list = llist_del_all(&priv->updates);
+    toggles = atomic_xchg(&priv->toggle_reqs, 0);
+    if (!list && !toggles)
+        return;
+
+    /* llist is LIFO, restore the order of writes */
+    list = llist_reverse_order(list);
+
+    mutex_lock(&priv->bus_lock);
+
+    llist_for_each_entry_safe(upd, next, list, node) {
+        pos = upd->pos;
+        lcd1602a_render(lcd1602a_client_buf(upd->client), NULL, &upd->client->region,
+                        upd->data, upd->len, &pos);
+        compose |= lcd1602a_client_touch(upd->client, pos);
+        upd->client->rendered = true;
+        atomic_dec(&priv->nr_updates);
+        lcd1602a_update_put(priv, upd);
+    }
+
+    /* Writes which came after remove() are dropped */
+    if (compose && !priv->removed)
+        ret = lcd1602a_compose(priv);
+
+    /* Error goes to the writers whose text was in the failed frame */
+    list_for_each_entry(client, &priv->clients, node) {
+        if (client->rendered && ret)
+            WRITE_ONCE(client->update_err, ret);
+        client->rendered = false;
+    }
+
+    if ((toggles & 1) && !priv->removed)
+        lcd1602a_toggle_display(priv);
+
+    mutex_unlock(&priv->bus_lock);
+
+    wake_up_interruptible(&priv->wqueue_wait);
+}
+
+/* Queue a write for update_work. Only O_NONBLOCK writers get -EAGAIN on the
+ * full queue, the others wait for room but never for the bus itself. */
+static ssize_t lcd1602a_queue_write(struct lcd1602a_client *client, const char __user *buf, size_t count, loff_t *ppos, bool nonblock)
+{
+    int i, ret;
+    loff_t virt_pos = *ppos;
+    struct lcd1602a_update *upd;
+    struct lcd1602a_data *priv = client->priv;
+    struct lcd_region rgn = client->region;
+
+    upd = lcd1602a_update_get(priv);
+    if (!upd) {
+        if (nonblock)
+            return -EAGAIN;
+
+        ret = wait_event_interruptible(priv->wqueue_wait, (upd = lcd1602a_update_get(priv)));
+        if (ret)
+            return ret;
+    }
+
+    upd->client = client;
+    upd->pos = *ppos;
+    upd->len = count;
+    if (copy_from_user(upd->data, buf, count)) {
+        lcd1602a_update_put(priv, upd);
+        return -EFAULT;
+    }
+
+    atomic_inc(&priv->nr_updates);
+
+    /* Report the same position and size as the synchronous write would do.
+     * The record belongs to update_work once it is queued. */
+    for (i = 0; i < count && virt_pos < lcd1602a_rgn_write_size(&rgn); i++)
+        virt_pos = lcd1602a_next_pos(virt_pos, upd->data[i], lcd1602a_rgn_row_size(&rgn));
+
+    llist_add(&upd->node, &priv->updates);
+    schedule_work(&priv->update_work);
+
+    *ppos = virt_pos;
+    return count;
+}
+
+static ssize_t lcd1602a_write(struct file *filp, const char __user *buf, size_t count, loff_t *ppos)
+{
+    int ret, write_size;
+    struct lcd1602a_client *client = filp->private_data;
+    struct lcd1602a_data *priv = client->priv;
+
+    if (!test_bit(LCD_VISIBLE_FLAG, &priv->state_flags))
+        return -EIO;
+
+    /* Bus error of the file's previously queued writes */
+    ret = xchg(&client->update_err, 0);
+    if (ret)
+        return ret;
+
+    /* Writes are clipped by the file's region */
+    write_size = lcd1602a_rgn_write_size(&client->region);
+
+    /* Handle EOF and zero count */
+    if (*ppos >= write_size)
+        return -ENOSPC;
+    if (!count)
+        return 0;
+
+    if (count > write_size - *ppos)
+        count = write_size - *ppos;
+
+    return lcd1602a_queue_write(client, buf, count, ppos, filp->f_flags & O_NONBLOCK);
+}
+
+static __poll_t lcd1602a_poll(struct file *filp, struct poll_table_struct *wait)
+{
+    __poll_t mask = 0;
+    struct lcd1602a_client *client = filp->private_data;
+    struct lcd1602a_data *priv = client->priv;
+
+    poll_wait(filp, &priv->wqueue_wait, wait);
+
+    if (!test_bit(LCD_VISIBLE_FLAG, &priv->state_flags))
+        return EPOLLERR;
+
+    if (!atomic_read(&priv->nr_updates))
+        mask |= EPOLLIN | EPOLLRDNORM;
+
+    /* write() needs a free record, nr_updates is dropped before its record */
+    if (READ_ONCE(priv->updates_used) != GENMASK(LCD_UPDATES_MAX - 1, 0))
+        mask |= EPOLLOUT | EPOLLWRNORM;
+
+    return mask;
+}
+
+/***** Batched display operations (LCD_IOC_BATCH and io_uring commands) *****/
+
+static struct lcd_op *lcd1602a_copy_ops(const struct lcd_batch *batch)
+{
+    if (!batch->nr_ops || batch->nr_ops > LCD_BATCH_MAX_OPS || batch->flags)
+        return ERR_PTR(-EINVAL);
+
+    return memdup_array_user(u64_to_user_ptr(batch->ops), batch->nr_ops, sizeof(struct lcd_op));
+}
+
+/* Must be called with priv->bus_lock held. Text runs are rendered into the client's
+ * buffer and the screen is composed once at the end. Returns number of executed ops. */
+static int lcd1602a_run_ops(struct lcd1602a_client *client, const struct lcd_op *ops, unsigned int nr_ops)
+{
+    int i, err, ret = 0;
+    loff_t virt_pos = 0;
+    bool render = false;
+    struct lcd1602a_data *priv = client->priv;
+
+    for (i = 0; i < nr_ops && !ret; i++) {
+        switch (ops[i].type) {
+        case LCD_OP_TEXT:
+            if (ops[i].pos >= lcd1602a_rgn_write_size(&client->region) || ops[i].len > LCD_OP_DATA_SIZE) {
+                ret = -EINVAL;
+                break;
+            }
+
+            virt_pos = ops[i].pos;
+            lcd1602a_render(lcd1602a_client_buf(client), NULL, &client->region,
+                            ops[i].data, ops[i].len, &virt_pos);
+            render = true;
+            break;
+
+        case LCD_OP_CURSOR:
+            if (ops[i].value > 1) {
+                ret = -EINVAL;
+                break;
+            }
+
+            ret = lcd1602a_cursor_op(priv, ops[i].value);
+            break;
+
+        case LCD_OP_BACKLIGHT:
+            ret = lcd1602a_backlight_switch(priv, ops[i].value);
+            break;
+
+        case LCD_OP_CGRAM:
+            if (priv->glyph_users) {
+                ret = -EBUSY;
+                break;
+            }
+
+            priv->glyphs = LCD_GLYPHS_NONE;
+            ret = lcd1602a_cgram_op(priv, ops[i].pos, ops[i].data);
+            break;
+
+        default:
+            ret = -EINVAL;
+        }
+    }
+
+    /* Text rendered before a failed op is still shown */
+    if (render && lcd1602a_client_touch(client, virt_pos)) {
+        err = lcd1602a_compose(priv);
+        if (!ret)
+            ret = err;
+    }
+
+    return (ret) ? ret : i;
+}
+
+static int lcd1602a_uring_cmd(struct io_uring_cmd *ioucmd, unsigned int issue_flags)
+{
+    int ret;
+    struct lcd_op *ops;
+    struct lcd_batch batch;
+    const struct lcd_batch *sqe_batch = io_uring_sqe_cmd(ioucmd->sqe);
+    struct lcd1602a_client *client = ioucmd->file->private_data;
+    struct lcd1602a_data *priv = client->priv;
+
+    if (ioucmd->cmd_op != LCD_IOC_BATCH)
+        return -ENOTTY;
+
+    if (!test_bit(LCD_VISIBLE_FLAG, &priv->state_flags))
+        return -EIO;
+
+    /* SQE is shared with userspace */
+    batch.ops = READ_ONCE(sqe_batch->ops);
+    batch.nr_ops = READ_ONCE(sqe_batch->nr_ops);
+    batch.flags = READ_ONCE(sqe_batch->flags);
+
+    ops = lcd1602a_copy_ops(&batch);
+    if (IS_ERR(ops))
+        return PTR_ERR(ops);
+
+    /* io_uring retries from a worker thread if we can't run without blocking.
+     * Text of the file's queued writes must not land over the batch's one. */
+    if (issue_flags & IO_URING_F_NONBLOCK) {
+        if (!lcd1602a_is_committed(priv) || !mutex_trylock(&priv->bus_lock)) {
+            kfree(ops);
+            return -EAGAIN;
+        }
+        if (!lcd1602a_is_committed(priv)) {
+            mutex_unlock(&priv->bus_lock);
+            kfree(ops);
+            return -EAGAIN;
+        }
+    } else {
+        ret = lcd1602a_lock_committed(priv, false);
+        if (ret) {
+            kfree(ops);
+            return ret;
+        }
+    }
+
+    ret = (priv->removed) ? -ENODEV : lcd1602a_run_ops(client, ops, batch.nr_ops);
+    mutex_unlock(&priv->bus_lock);
+
+    kfree(ops);
+    return ret;
+}
+
+static long lcd1602a_ioctl(struct file *filp, unsigned int cmd, unsigned long arg)
+{
+    long ret = -EFAULT;
+    int i, prio, row, col;
+    unsigned int res = 0;
+    struct lcd_frame frame;
+    struct lcd_batch batch;
+    struct lcd_overlay overlay;
+    struct lcd_region region;
+    struct lcd_widget widget;
+    struct lcd_clock clock;
+    struct lcd_op *ops = NULL;
+    struct lcd1602a_client *client = filp->private_data;
+    struct lcd1602a_data *priv = client->priv;
+
+    /* Shadow state queries, no need to wait for the bus */
+    if (cmd == LCD_IOC_CURSOR_GET) {
+        res = test_bit(LCD_CURSOR_FLAG, &priv->state_flags);
+        return put_user(res, (unsigned int __user *)arg);
+    }
+
+    if (cmd == LCD_IOC_PRIORITY_GET)
+        return put_user(READ_ONCE(client->priority), (int __user *)arg);
+
+    if (cmd == LCD_IOC_VIEWPORT_GET)
+        return put_user(READ_ONCE(priv->view_offset), (unsigned int __user *)arg);
+
+    if (cmd == LCD_IOC_REGION_GET) {
+        region = client->region;
+        if (copy_to_user((void __user *)arg, &region, sizeof(region)))
+            return -EFAULT;
+        return 0;
+    }
+
+    if (cmd == LCD_IOC_SCREENSHOT) {
+        struct lcd_frame shot;
+        struct lcd1602a_snapshot snap;
+
+        BUILD_BUG_ON(LCD_FRAME_ROWS != LCD_ROWS || LCD_FRAME_COLS != LCD_COLS);
+        lcd1602a_snapshot_read(priv, &snap);
+        lcd1602a_snapshot_view(&snap, shot.cells);
+        if (copy_to_user((void __user *)arg, &shot, sizeof(shot)))
+            return -EFAULT;
+        return 0;
+    }
+
+    if (cmd == LCD_IOC_BATCH) {
+        if (!test_bit(LCD_VISIBLE_FLAG, &priv->state_flags))
+            return -EIO;
+        if (copy_from_user(&batch, (void __user *)arg, sizeof(batch)))
+            return -EFAULT;
+        ops = lcd1602a_copy_ops(&batch);
+        if (IS_ERR(ops))
+            return PTR_ERR(ops);
+    }
+
+    /* Composing starts from the client's content including its queued writes
+     * and the committed frame takes the writes issued while composing.
+     * Queued writes are rendered by the region they were written to.
+     * Batches and widgets are drawn over the writes which came before. */
+    if (cmd == LCD_IOC_FRAME_BEGIN || cmd == LCD_IOC_FRAME_SET || cmd == LCD_IOC_FRAME_COMMIT ||
+        cmd == LCD_IOC_REGION_SET || cmd == LCD_IOC_BATCH || cmd == LCD_IOC_WIDGET ||
+        cmd == LCD_IOC_CLOCK) {
+        ret = lcd1602a_lock_committed(priv, filp->f_flags & O_NONBLOCK);
+        if (ret) {
+            kfree(ops);
+            return ret;
+        }
+        ret = -EFAULT;
+    } else {
+        mutex_lock(&priv->bus_lock);
+    }
+
+    /* File outlived the device, the bus must not be touched */
+    if (priv->removed) {
+        ret = -ENODEV;
+        goto ioctl_err;
+    }
+
+    switch (cmd) {
+    case LCD_IOC_CURSOR_SET:
+        if (get_user(res, (unsigned int __user *)arg))
+            goto ioctl_err;
+        if (res > 1) {
+            ret = -EINVAL;
+            goto ioctl_err;
+        }
+
+        ret = lcd1602a_cursor_op(priv, (bool) res);
+        if (ret)
+            goto ioctl_err;
+        break;
+
+    case LCD_IOC_FRAME_BEGIN:
+        memcpy(client->frame, client->cells, sizeof(client->frame));
+        client->composing = true;
+        ret = 0;
+        break;
+
+    case LCD_IOC_FRAME_SET:
+        if (copy_from_user(&frame, (void __user *)arg, sizeof(frame)))
+            goto ioctl_err;
+
+        /* Without FRAME_BEGIN the columns outside of the window keep the
+         * client's content. Frame covers the visible part of DDRAM in
+         * viewport mode. */
+        if (!client->composing)
+            memcpy(client->frame, client->cells, sizeof(client->frame));
+        for (row = 0; row < LCD_ROWS; row++)
+            for (col = 0; col < LCD_COLS; col++)
+                client->frame[row][(priv->view_offset + col) % priv->screen.cols] = frame.cells[row][col];
+        client->composing = true;
+        ret = 0;
+        break;
+
+    case LCD_IOC_FRAME_COMMIT:
+        if (!client->composing) {
+            ret = -EINVAL;
+            goto ioctl_err;
+        }
+
+        client->composing = false;
+        memcpy(client->cells, client->frame, sizeof(client->cells));
+        lcd1602a_client_touch(client, filp->f_pos);
+        ret = lcd1602a_compose(priv);
+        break;
+
+    case LCD_IOC_BATCH:
+        ret = lcd1602a_run_ops(client, ops, batch.nr_ops);
+        break;
+
+    case LCD_IOC_OVERLAY:
+        if (copy_from_user(&overlay, (void __user *)arg, sizeof(overlay)))
+            goto ioctl_err;
+
+        ret = lcd1602a_overlay_set(priv, &overlay);
+        break;
+
+    case LCD_IOC_REGION_SET:
+        if (copy_from_user(&region, (void __user *)arg, sizeof(region)))
+            goto ioctl_err;
+
+        if (!region.rows || !region.cols ||
+            region.row + region.rows > LCD_ROWS ||
+            region.col + region.cols > priv->screen.cols) {
+            ret = -EINVAL;
+            goto ioctl_err;
+        }
+
+        client->region = region;
+        filp->f_pos = 0;
+
+        /* Clock and widgets which don't fit the new region are dropped */
+        if (client->clock.format[0] &&
+            (client->clock.row >= region.rows || client->clock.col >= region.cols)) {
+            client->clock.format[0] = '\0';
+            priv->clocks--;
+        }
+
+        for (i = 0; i < LCD_WIDGETS_MAX; i++)
+            if (client->widgets[i].type &&
+                lcd1602a_widget_check(&client->widgets[i], &region))
+                lcd1602a_widget_drop(client, i);
+
+        ret = lcd1602a_compose(priv);
+        break;
+
+    case LCD_IOC_WIDGET:
+        if (copy_from_user(&widget, (void __user *)arg, sizeof(widget)))
+            goto ioctl_err;
+
+        ret = lcd1602a_widget_set(client, &widget, filp->f_pos);
+        break;
+
+    case LCD_IOC_CLOCK:
+        if (copy_from_user(&clock, (void __user *)arg, sizeof(clock)))
+            goto ioctl_err;
+
+        ret = lcd1602a_clock_set(client, &clock, filp->f_pos);
+        break;
+
+    case LCD_IOC_VIEWPORT_SET:
+        if (get_user(res, (unsigned int __user *)arg))
+            goto ioctl_err;
+        if (res >= priv->screen.cols || (res && priv->screen.cols != DDRAM_ROW_LENGTH)) {
+            ret = -EINVAL;
+            goto ioctl_err;
+        }
+
+        WRITE_ONCE(priv->view_offset, res);
+        ret = lcd1602a_batch_viewport(priv);
+        if (!ret)
+            ret = lcd1602a_batch_flush(priv);
+        if (!ret)
+            lcd1602a_snapshot_publish(priv);
+        break;
+
+    case LCD_IOC_PRIORITY_SET:
+        if (get_user(prio, (int __user *)arg))
+            goto ioctl_err;
+
+        /* Background content shows up at once when the top one steps down */
+        WRITE_ONCE(client->priority, prio);
+        ret = lcd1602a_compose(priv);
+        break;
+
+    default:
+        ret = -ENOTTY;
+    }
+
+ioctl_err:
+    mutex_unlock(&priv->bus_lock);
+    kfree(ops);
+    return ret;
+}
+
+/***** In-kernel client API *****/
+
+struct lcd1602a_handle *lcd1602a_get(struct device_node *np)
+{
+    int ret;
+    struct lcd1602a_handle *handle;
+    struct lcd1602a_data *iter, *priv = NULL;
+
+    mutex_lock(&lcd1602a_devices_lock);
+    list_for_each_entry(iter, &lcd1602a_devices, node) {
+        if (iter->dev->of_node == np) {
+            priv = iter;
+            kref_get(&priv->ref);
+            break;
+        }
+    }
+    mutex_unlock(&lcd1602a_devices_lock);
+
+    if (!priv)
+        return ERR_PTR(-EPROBE_DEFER);
+
+    handle = kzalloc(sizeof(*handle), GFP_KERNEL);
+    if (!handle) {
+        ret = -ENOMEM;
+        goto get_err;
+    }
+
+    mutex_lock(&priv->bus_lock);
+    if (priv->removed) {
+        mutex_unlock(&priv->bus_lock);
+        ret = -ENODEV;
+        goto get_err;
+    }
+
+    lcd1602a_client_init(priv, &handle->client);
+    mutex_unlock(&priv->bus_lock);
+
+    return handle;
+
+get_err:
+    kfree(handle);
+    kref_put(&priv->ref, lcd1602a_free);
+    return ERR_PTR(ret);
+}
+EXPORT_SYMBOL_GPL(lcd1602a_get);
+
+struct lcd1602a_handle *lcd1602a_get_by_phandle(struct device *dev, const char *propname)
+{
+    struct lcd1602a_handle *handle;
+    struct device_node *np = of_parse_phandle(dev->of_node, propname, 0);
+
+    if (!np)
+        return ERR_PTR(-ENODEV);
+
+    handle = lcd1602a_get(np);
+    of_node_put(np);
+    return handle;
+}
+EXPORT_SYMBOL_GPL(lcd1602a_get_by_phandle);
+
+void lcd1602a_put(struct lcd1602a_handle *handle)
+{
+    struct lcd1602a_data *priv = handle->client.priv;
+
+    /* Lower priority content shows up */
+    mutex_lock(&priv->bus_lock);
+    list_del(&handle->client.node);
+    if (handle->client.active && !priv->removed)
+        lcd1602a_compose(priv);
+    mutex_unlock(&priv->bus_lock);
+
+    kfree(handle);
+    kref_put(&priv->ref, lcd1602a_free);
+}
+EXPORT_SYMBOL_GPL(lcd1602a_put);
+
+/* Lock the bus unless the LCD is gone or its content is owned by charlcd */
+static int lcd1602a_handle_lock(struct lcd1602a_data *priv)
+{
+    mutex_lock(&priv->bus_lock);
+
+    if (priv->removed) {
+        mutex_unlock(&priv->bus_lock);
+        return -ENODEV;
+    }
+
+    if (test_bit(LCD_CHARLCD_FLAG, &priv->state_flags)) {
+        mutex_unlock(&priv->bus_lock);
+        return -EBUSY;
+    }
+
+    return 0;
+}
+
+int lcd1602a_write_text(struct lcd1602a_handle *handle, unsigned int row, unsigned int col,
+                        const char *text, size_t len)
+{
+    int ret;
+    loff_t pos;
+    struct lcd1602a_client *client = &handle->client;
+    struct lcd1602a_data *priv = client->priv;
+
+    if (row >= client->region.rows || col >= client->region.cols || len > LCD_VIRT_WRITE_SIZE)
+        return -EINVAL;
+
+    ret = lcd1602a_handle_lock(priv);
+    if (ret)
+        return ret;
+
+    pos = row * lcd1602a_rgn_row_size(&client->region) + col;
+    lcd1602a_render(client->cells, NULL, &client->region, text, len, &pos);
+
+    lcd1602a_client_touch(client, pos);
+    ret = lcd1602a_compose(priv);
+    mutex_unlock(&priv->bus_lock);
+
+    return ret;
+}
+EXPORT_SYMBOL_GPL(lcd1602a_write_text);
+
+int lcd1602a_show_overlay(struct lcd1602a_handle *handle, unsigned int row, unsigned int col,
+                          const char *text, size_t len, unsigned int timeout_ms)
+{
+    int ret;
+    struct lcd_overlay req = { .timeout_ms = timeout_ms };
+    struct lcd1602a_data *priv = handle->client.priv;
 
-    if (filp->f_flags & O_TRUNC) {
-        ret = lcd1602a_clear(priv);
-        if (ret)
-            goto open_err;
-    }
+    if (row >= priv->screen.rows || col >= priv->screen.cols || len > LCD_OP_DATA_SIZE)
+        return -EINVAL;
 
-    if (filp->f_flags & O_APPEND) {
-        ret = lcd1602a_get_current_address(priv);
-        if (ret < 0)
-            goto open_err;
+    req.pos = row * lcd1602a_rgn_row_size(&priv->screen) + col;
+    req.len = len;
+    memcpy(req.data, text, len);
 
-        if (ret >= DDRAM_1ROW_OFFSET &&
-            ret <= DDRAM_1ROW_OFFSET + DDRAM_ROW_LENGTH)
-            filp->f_pos = ret - DDRAM_1ROW_OFFSET;
-        else if (ret >= DDRAM_2ROW_OFFSET &&
-                 ret <= DDRAM_2ROW_OFFSET + DDRAM_ROW_LENGTH)
-            filp->f_pos = (ret - DDRAM_2ROW_OFFSET) + DDRAM_ROW_LENGTH + 1;
-        else
-            filp->f_pos = 2 * DDRAM_ROW_LENGTH + 2;
+    ret = lcd1602a_handle_lock(priv);
+    if (ret)
+        return ret;
+
+    ret = lcd1602a_overlay_set(priv, &req);
+    mutex_unlock(&priv->bus_lock);
+
+    return ret;
+}
+EXPORT_SYMBOL_GPL(lcd1602a_show_overlay);
+
+int lcd1602a_set_backlight(struct lcd1602a_handle *handle, bool on)
+{
+    int ret;
+    struct lcd1602a_data *priv = handle->client.priv;
+
+    /* remove() stops the PWM after the LCD is marked as removed */
+    mutex_lock(&priv->bus_lock);
+    if (priv->removed) {
+        mutex_unlock(&priv->bus_lock);
+        return -ENODEV;
     }
 
-    ret = 0;
+    ret = lcd1602a_backlight_switch(priv, on);
+    mutex_unlock(&priv->bus_lock);
 
-open_err:
-    mutex_unlock(&priv->lock);
     return ret;
 }
+EXPORT_SYMBOL_GPL(lcd1602a_set_backlight);
 
-static int lcd1602a_release(struct inode *inode, struct file *filp)
+static struct file_operations lcd1602a_fops = {
+    .owner = THIS_MODULE,
+    .llseek = lcd1602_llseek,
+    .open = lcd1602a_open,
+    .release = lcd1602a_release,
+    .read = lcd1602a_read,
+    .write = lcd1602a_write,
+    .poll = lcd1602a_poll,
+    .unlocked_ioctl = lcd1602a_ioctl,
+    .compat_ioctl = compat_ptr_ioctl,
+    .uring_cmd = lcd1602a_uring_cmd,
+};
+
+/***** debugfs *****/
+
+static struct dentry *lcd1602a_debugfs_root;
+
+static int lcd1602a_screen_show(struct seq_file *s, void *unused)
 {
-    struct lcd1602a_data *priv = filp->private_data;
-    clear_bit(LCD_OPENED_FLAG, &priv->state_flags);
+    int row;
+    u8 cells[LCD_ROWS][LCD_COLS];
+    struct lcd1602a_snapshot snap;
+    struct lcd1602a_data *priv = s->private;
+
+    lcd1602a_snapshot_read(priv, &snap);
+    lcd1602a_snapshot_view(&snap, cells);
+
+    for (row = 0; row < LCD_ROWS; row++) {
+        seq_write(s, cells[row], LCD_COLS);
+        seq_putc(s, '\n');
+    }
+
     return 0;
 }
+DEFINE_SHOW_ATTRIBUTE(lcd1602a_screen);
 
-static ssize_t lcd1602a_read(struct file *filp, char __user *buf, size_t count, loff_t *ppos)
+static void lcd1602a_debugfs_init(struct lcd1602a_data *priv)
 {
-    int i = 0;
-    ssize_t ret = -EFAULT;
-    unsigned char *tmp = NULL;
-    struct lcd1602a_data *priv = filp->private_data;
+    priv->debugfs = debugfs_create_dir(dev_name(priv->dev), lcd1602a_debugfs_root);
+    debugfs_create_file("screen", S_IRUSR, priv->debugfs, priv, &lcd1602a_screen_fops);
+}
 
-    /* We are going to read by rows which have 17 chars. The 17th char is always '\n'. */
-    int virt_row_size = DDRAM_ROW_LENGTH + 1;
-    loff_t virt_pos = *ppos;
-    loff_t rel_virt_pos = virt_pos % virt_row_size;
+/***** sysfs attribute-files handling *****/
 
-    if (!test_bit(LCD_VISIBLE_FLAG, &priv->state_flags))
-        return -EIO;
+static ssize_t lcd1602a_backlight_show(struct device *dev, struct device_attribute *attr, char *buf)
+{
+    struct lcd1602a_data *priv = dev_get_drvdata(dev);
 
-    /* Handle zero count or EOF */
-    if (!count || (*ppos >= 2 * virt_row_size))
-        return 0;
+    return sysfs_emit(buf, "%d\n", READ_ONCE(priv->bl.target) > 0);
+}
 
-    if (count > virt_row_size - rel_virt_pos)
-        count = virt_row_size - rel_virt_pos;
+static ssize_t lcd1602a_backlight_store(struct device *dev, struct device_attribute *attr, const char *buf, size_t count)
+{
+    int ret;
+    bool res;
+    struct lcd1602a_data *priv = dev_get_drvdata(dev);
 
-    tmp = kzalloc(count * sizeof(*tmp), GFP_KERNEL);
-    if (!tmp)
-        return -ENOMEM;
+    if (kstrtobool(buf, &res))
+        return -EFAULT;
 
-    mutex_lock(&priv->lock);
+    mutex_lock(&priv->bus_lock);
+    ret = (priv->removed) ? -ENODEV : lcd1602a_backlight_switch(priv, res);
+    mutex_unlock(&priv->bus_lock);
 
-    /* Sync cursor and file position */
-    ret = lcd1602a_set_current_address(priv, *ppos);
-    if (ret)
-        goto read_err;
+    return (ret) ? ret : count;
+}
 
-    for (i = 0; i < count; i++) {
+static DEVICE_ATTR(backlight, S_IWUSR | S_IRUGO, lcd1602a_backlight_show, lcd1602a_backlight_store);
 
-        /* Check 'new line' position */
-        if (rel_virt_pos == DDRAM_ROW_LENGTH) {
-            lcd1602a_set_current_address(priv, virt_pos + 1);
-            tmp[i] = '\n';
-        } else {
-            ret = lcd1602a_getchar(priv);
-            if (ret < 0)
-                goto read_err;
-            tmp[i] = ret;
-        }
+static ssize_t lcd1602a_max_fps_show(struct device *dev, struct device_attribute *attr, char *buf)
+{
+    struct lcd1602a_data *priv = dev_get_drvdata(dev);
 
-        virt_pos++;
-        rel_virt_pos = virt_pos % virt_row_size;
-    }
+    return sysfs_emit(buf, "%u\n", READ_ONCE(priv->max_fps));
+}
 
-    mutex_unlock(&priv->lock);
+static ssize_t lcd1602a_max_fps_store(struct device *dev, struct device_attribute *attr, const char *buf, size_t count)
+{
+    unsigned int res;
+    struct lcd1602a_data *priv = dev_get_drvdata(dev);
 
-    if (copy_to_user(buf, tmp, count)) {
-        ret = -EFAULT;
-    } else {
-        *ppos = virt_pos;
-        ret = count;
+    if (kstrtouint(buf, 0, &res))
+        return -EINVAL;
+
+    lcd1602a_set_max_fps(priv, res);
+
+    /* Don't keep the deferred frame for the old period */
+    mutex_lock(&priv->bus_lock);
+    if (priv->removed) {
+        mutex_unlock(&priv->bus_lock);
+        return -ENODEV;
     }
+    if (!res)
+        mod_delayed_work(system_wq, &priv->commit_work, 0);
+    mutex_unlock(&priv->bus_lock);
 
-    kfree(tmp);
-    return ret;
+    return count;
+}
 
-read_err:
-    mutex_unlock(&priv->lock);
-    kfree(tmp);
-    return ret;
+static DEVICE_ATTR(max_fps, S_IWUSR | S_IRUGO, lcd1602a_max_fps_show, lcd1602a_max_fps_store);
+
+static ssize_t lcd1602a_fade_ms_show(struct device *dev, struct device_attribute *attr, char *buf)
+{
+    struct lcd1602a_data *priv = dev_get_drvdata(dev);
+
+    return sysfs_emit(buf, "%u\n", READ_ONCE(priv->bl.fade_ms));
 }
 
-static ssize_t lcd1602a_write(struct file *filp, const char __user *buf, size_t count, loff_t *ppos)
+static ssize_t lcd1602a_fade_ms_store(struct device *dev, struct device_attribute *attr, const char *buf, size_t count)
 {
-    int i = 0;
-    ssize_t ret = -EFAULT;
-    unsigned char *tmp = NULL;
-    struct lcd1602a_data *priv = filp->private_data;
-
-    /* We are going to write by rows which have 17 chars. The 17th char is always '\n'. */
-    int virt_row_size = DDRAM_ROW_LENGTH + 1;
-    /* 2 phys rows by 16 chars and 1 virtual '\n' between them */
-    int max_virt_size = 2 * virt_row_size - 1;
-    loff_t virt_pos = *ppos;
-    int rel_virt_pos = virt_pos % virt_row_size;
+    u32 res;
+    unsigned long flags;
+    struct lcd1602a_data *priv = dev_get_drvdata(dev);
 
-    if (!test_bit(LCD_VISIBLE_FLAG, &priv->state_flags))
-        return -EIO;
+    if (kstrtou32(buf, 0, &res))
+        return -EINVAL;
 
-    /* Handle EOF and zero count */
-    if (*ppos >= max_virt_size)
-        return -ENOSPC;
-    if (!count)
-        return 0;
+    if (READ_ONCE(priv->removed))
+        return -ENODEV;
 
-    if (count > max_virt_size - *ppos)
-        count = max_virt_size - *ppos;
+    spin_lock_irqsave(&priv->bl.lock, flags);
+    priv->bl.fade_ms = res;
+    spin_unlock_irqrestore(&priv->bl.lock, flags);
 
-    tmp = kzalloc(count * sizeof(*tmp), GFP_KERNEL);
-    if (!tmp)
-        return -ENOMEM;
+    return count;
+}
 
-    if (copy_from_user(tmp, buf, count)) {
-        kfree(tmp);
-        return -EFAULT;
-    }
+static DEVICE_ATTR(fade_ms, S_IWUSR | S_IRUGO, lcd1602a_fade_ms_show, lcd1602a_fade_ms_store);
 
-    mutex_lock(&priv->lock);
+static ssize_t lcd1602a_pwm_max_writes_show(struct device *dev, struct device_attribute *attr, char *buf)
+{
+    struct lcd1602a_data *priv = dev_get_drvdata(dev);
 
-    /* Sync cursor and file position */
-    ret = lcd1602a_set_current_address(priv, *ppos);
-    if (ret)
-        goto write_err;
+    return sysfs_emit(buf, "%u\n", READ_ONCE(priv->bl.max_writes));
+}
 
-    for (i = 0; i < count; i++) {
+static ssize_t lcd1602a_pwm_max_writes_store(struct device *dev, struct device_attribute *attr, const char *buf, size_t count)
+{
+    u32 res;
+    unsigned long flags;
+    struct lcd1602a_data *priv = dev_get_drvdata(dev);
 
-        /* '\n' as 17th char in the virtual row */
-        if (rel_virt_pos == DDRAM_ROW_LENGTH) {
-            virt_pos++;
-            if (tmp[i] == '\n')
-                continue;
-            rel_virt_pos = virt_pos % virt_row_size;
+    if (kstrtou32(buf, 0, &res) || !res)
+        return -EINVAL;
 
-            /* Move cursor to the next row */
-            ret = lcd1602a_set_current_address(priv, *ppos + 1);
-            if (ret)
-                goto write_err;
-        }
+    if (READ_ONCE(priv->removed))
+        return -ENODEV;
 
-        /* '\n' in the virtual row before 17th char. Fill the rest of the
-         * row with spaces and then move the cursor to the next row. */
-        if (tmp[i] == '\n') {
-            while (rel_virt_pos < DDRAM_ROW_LENGTH) {
-                ret = lcd1602a_putchar(priv, ' ');
-                if (ret)
-                    goto write_err;
+    spin_lock_irqsave(&priv->bl.lock, flags);
+    WRITE_ONCE(priv->bl.max_writes, res);
+    spin_unlock_irqrestore(&priv->bl.lock, flags);
 
-                (*ppos)++;
-                virt_pos++;
-                rel_virt_pos = virt_pos % virt_row_size;
-            }
+    return count;
+}
 
-            virt_pos++;
-            /* Move cursor to the next row */
-            ret = lcd1602a_set_current_address(priv, *ppos + 1);
-            if (ret)
-                goto write_err;
-        } else {
-            /* Usual putchar case */
-            ret = lcd1602a_putchar(priv, tmp[i]);
-            if (ret)
-                goto write_err;
+static DEVICE_ATTR(pwm_max_writes, S_IWUSR | S_IRUGO, lcd1602a_pwm_max_writes_show, lcd1602a_pwm_max_writes_store);
 
-            (*ppos)++;
-            virt_pos++;
-        }
-        rel_virt_pos = virt_pos % virt_row_size;
-    }
+static ssize_t lcd1602a_template_show(struct device *dev, struct device_attribute *attr, char *buf)
+{
+    ssize_t ret;
+    struct lcd1602a_data *priv = dev_get_drvdata(dev);
 
-    ret = i;
+    mutex_lock(&priv->bus_lock);
+    ret = sysfs_emit(buf, "%s\n", priv->status.tmpl);
+    mutex_unlock(&priv->bus_lock);
 
-write_err:
-    kfree(tmp);
-    mutex_unlock(&priv->lock);
     return ret;
 }
 
-static long lcd1602a_ioctl(struct file *filp, unsigned int cmd, unsigned long arg)
+static ssize_t lcd1602a_template_store(struct device *dev, struct device_attribute *attr, const char *buf, size_t count)
 {
-    long ret = -EFAULT;
-    unsigned int res = 0;
-    struct lcd1602a_data *priv = filp->private_data;
+    int ret;
+    char tmpl[LCD_TEMPLATE_SIZE];
+    struct lcd1602a_data *priv = dev_get_drvdata(dev);
 
-    mutex_lock(&priv->lock);
+    /* Trailing newline of echo isn't a part of the template */
+    if (count >= sizeof(tmpl))
+        return -EINVAL;
+    memcpy(tmpl, buf, count);
+    tmpl[(count && buf[count - 1] == '\n') ? count - 1 : count] = '\0';
 
-    switch (cmd) {
-    case LCD_IOC_CURSOR_GET:
-        if (test_bit(LCD_CURSOR_FLAG, &priv->state_flags))
-            res = 1;
-        if (put_user(res, (unsigned int __user *)arg))
-            goto ioctl_err;
-        ret = 0;
-        break;
+    if (!test_bit(LCD_VISIBLE_FLAG, &priv->state_flags))
+        return -EIO;
 
-    case LCD_IOC_CURSOR_SET:
-        if (get_user(res, (unsigned int __user *)arg))
-            goto ioctl_err;
-        if (res > 1) {
-            ret = -EINVAL;
-            goto ioctl_err;
-        }
+    /* Content is owned by charlcd layer (/dev/lcd misc device) */
+    if (test_bit(LCD_CHARLCD_FLAG, &priv->state_flags))
+        return -EBUSY;
 
-        ret = lcd1602a_cursor_op(priv, (bool) res);
-        if (ret)
-            goto ioctl_err;
-        break;
+    ret = lcd1602a_lock_committed(priv, false);
+    if (ret)
+        return ret;
 
-    default:
-        ret = -ENOTTY;
-    }
+    ret = (priv->removed) ? -ENODEV : lcd1602a_template_set(priv, tmpl);
+    mutex_unlock(&priv->bus_lock);
 
-ioctl_err:
-    mutex_unlock(&priv->lock);
-    return ret;
+    return (ret) ? ret : count;
 }
 
-static struct file_operations lcd1602a_fops = {
-    .owner = THIS_MODULE,
-    .llseek = lcd1602_llseek,
-    .open = lcd1602a_open,
-    .release = lcd1602a_release,
-    .read = lcd1602a_read,
-    .write = lcd1602a_write,
-    .unlocked_ioctl = lcd1602a_ioctl,
-    .compat_ioctl = compat_ptr_ioctl,
+static DEVICE_ATTR(template, S_IWUSR | S_IRUGO, lcd1602a_template_show, lcd1602a_template_store);
+
+/* "name=value" updates one field of the template */
+static ssize_t lcd1602a_field_store(struct device *dev, struct device_attribute *attr, const char *buf, size_t count)
+{
+    int ret;
+    size_t len = count;
+    const char *value;
+    struct lcd1602a_data *priv = dev_get_drvdata(dev);
+
+    if (len && buf[len - 1] == '\n')
+        len--;
+
+    value = memchr(buf, '=', len);
+    if (!value)
+        return -EINVAL;
+    value++;
+
+    if (!test_bit(LCD_VISIBLE_FLAG, &priv->state_flags))
+        return -EIO;
+
+    ret = lcd1602a_lock_committed(priv, false);
+    if (ret)
+        return ret;
+
+    ret = (priv->removed) ? -ENODEV : lcd1602a_field_set(priv, buf, value - buf - 1, value, buf + len - value);
+    mutex_unlock(&priv->bus_lock);
+
+    return (ret) ? ret : count;
+}
+
+static DEVICE_ATTR(field, S_IWUSR, NULL, lcd1602a_field_store);
+
+static struct attribute *lcd1602a_attrs[] = {
+    &dev_attr_backlight.attr,
+    &dev_attr_max_fps.attr,
+    &dev_attr_fade_ms.attr,
+    &dev_attr_pwm_max_writes.attr,
+    &dev_attr_template.attr,
+    &dev_attr_field.attr,
+    NULL,
 };
 
-/***** sysfs attribute-files handling *****/
+static const struct attribute_group lcd1602a_attr_group = {
+    .attrs = lcd1602a_attrs,
+};
 
-static ssize_t lcd1602a_backlight_show(struct device *dev, struct device_attribute *attr, char *buf)
+static ssize_t lcd1602a_debounce_last_us_show(struct device *dev, struct device_attribute *attr, char *buf)
 {
-    ssize_t count = 0;
     struct lcd1602a_data *priv = dev_get_drvdata(dev);
 
-    mutex_lock(&priv->lock);
-    count = sysfs_emit(buf, "%d\n", test_bit(LCD_BACKLIGHT_FLAG, &priv->state_flags));
-    mutex_unlock(&priv->lock);
+    return sysfs_emit(buf, "%u\n", READ_ONCE(priv->button.latency_last_us));
+}
 
-    return count;
+static DEVICE_ATTR(debounce_last_us, S_IRUGO, lcd1602a_debounce_last_us_show, NULL);
+
+static ssize_t lcd1602a_debounce_max_us_show(struct device *dev, struct device_attribute *attr, char *buf)
+{
+    struct lcd1602a_data *priv = dev_get_drvdata(dev);
+
+    return sysfs_emit(buf, "%u\n", READ_ONCE(priv->button.latency_max_us));
 }
 
-static ssize_t lcd1602a_backlight_store(struct device *dev, struct device_attribute *attr, const char *buf, size_t count)
+static DEVICE_ATTR(debounce_max_us, S_IRUGO, lcd1602a_debounce_max_us_show, NULL);
+
+static ssize_t lcd1602a_debounce_filtered_show(struct device *dev, struct device_attribute *attr, char *buf)
 {
-    bool res;
     struct lcd1602a_data *priv = dev_get_drvdata(dev);
 
-    if (kstrtobool(buf, &res))
-        return -EFAULT;
+    return sysfs_emit(buf, "%d\n", atomic_read(&priv->button.filtered_edges));
+}
 
-    mutex_lock(&priv->lock);
-    if (lcd1602a_backlight_op(priv, res)) {
-        mutex_unlock(&priv->lock);
-        return -EFAULT;
-    }
+static DEVICE_ATTR(debounce_filtered, S_IRUGO, lcd1602a_debounce_filtered_show, NULL);
 
-    mutex_unlock(&priv->lock);
-    return count;
+static ssize_t lcd1602a_pwm_writes_show(struct device *dev, struct device_attribute *attr, char *buf)
+{
+    struct lcd1602a_data *priv = dev_get_drvdata(dev);
+
+    return sysfs_emit(buf, "%d\n", atomic_read(&priv->bl.writes));
 }
 
-static DEVICE_ATTR(backlight, S_IWUSR | S_IRUGO, lcd1602a_backlight_show, lcd1602a_backlight_store);
+static DEVICE_ATTR(pwm_writes, S_IRUGO, lcd1602a_pwm_writes_show, NULL);
+
+static ssize_t lcd1602a_pwm_folded_show(struct device *dev, struct device_attribute *attr, char *buf)
+{
+    struct lcd1602a_data *priv = dev_get_drvdata(dev);
+
+    return sysfs_emit(buf, "%d\n", atomic_read(&priv->bl.folded));
+}
+
+static DEVICE_ATTR(pwm_folded, S_IRUGO, lcd1602a_pwm_folded_show, NULL);
+
+static ssize_t lcd1602a_cmds_skipped_show(struct device *dev, struct device_attribute *attr, char *buf)
+{
+    struct lcd1602a_data *priv = dev_get_drvdata(dev);
+
+    return sysfs_emit(buf, "%d\n", atomic_read(&priv->regs.skipped));
+}
+
+static DEVICE_ATTR(cmds_skipped, S_IRUGO, lcd1602a_cmds_skipped_show, NULL);
+
+/* Software debounce: latency from the first edge to the handled press/release.
+ * Backlight PWM: bus writes done and edges folded into other transfers.
+ * Commands not sent because HD44780 registers already held the same value. */
+static struct attribute *lcd1602a_stats_attrs[] = {
+    &dev_attr_debounce_last_us.attr,
+    &dev_attr_debounce_max_us.attr,
+    &dev_attr_debounce_filtered.attr,
+    &dev_attr_pwm_writes.attr,
+    &dev_attr_pwm_folded.attr,
+    &dev_attr_cmds_skipped.attr,
+    NULL,
+};
+
+static const struct attribute_group lcd1602a_stats_group = {
+    .name = "statistics",
+    .attrs = lcd1602a_stats_attrs,
+};
+
+static const struct attribute_group *lcd1602a_attr_groups[] = {
+    &lcd1602a_attr_group,
+    &lcd1602a_stats_group,
+    NULL,
+};
 
 /* "Linux Device Model" (I2C) section */
 
 static int lcd1602a_probe(struct i2c_client *client)
 {
-    int ret;
+    int i, ret;
     u32 debounce_ms;
     dev_t devid;
     struct lcd1602a_data *priv;
@@ -784,18 +3755,56 @@ static int lcd1602a_probe(struct i2c_client *client)
         return -EIO;
     }
 
-    priv = devm_kzalloc(&client->dev, sizeof(*priv), GFP_KERNEL);
+    /* In-kernel handles may outlive the device */
+    priv = kzalloc(sizeof(*priv), GFP_KERNEL);
     if (!priv) {
         dev_err(&client->dev, "Error! Could not allocate priv data!\n");
         return -ENOMEM;
     }
 
+    kref_init(&priv->ref);
+    ret = devm_add_action_or_reset(&client->dev, lcd1602a_put_data, priv);
+    if (ret)
+        return ret;
+
     priv->dev = &client->dev;
     priv->client = client;
+    priv->addr_pos = -1;
+    priv->screen.rows = LCD_ROWS;
+    priv->screen.cols = (viewport) ? DDRAM_ROW_LENGTH : LCD_COLS;
+
+    /* Plain I2C transfers allow to send a whole frame at once */
+    if (i2c_check_functionality(client->adapter, I2C_FUNC_I2C))
+        set_bit(LCD_I2C_BATCH_FLAG, &priv->state_flags);
+
+    /* Viewport mode uses the whole DDRAM, there is no hidden page */
+    if (page_flip && !viewport)
+        set_bit(LCD_PAGE_FLIP_FLAG, &priv->state_flags);
 
     dev_set_drvdata(priv->dev, priv);
 
-    mutex_init(&priv->lock);
+    mutex_init(&priv->bus_lock);
+    INIT_LIST_HEAD(&priv->clients);
+    priv->status.client.priv = priv;
+    priv->status.client.priority = LCD_PRIORITY_DEFAULT;
+
+    init_llist_head(&priv->updates);
+    for (i = 0; i < LCD_SNAPSHOTS; i++) {
+        priv->snap_pool[i].rcu_cookie = get_completed_synchronize_rcu();
+        priv->snap_pool[i].pooled = true;
+    }
+    INIT_WORK(&priv->update_work, lcd1602a_update_work);
+    init_waitqueue_head(&priv->wqueue_wait);
+    INIT_DELAYED_WORK(&priv->commit_work, lcd1602a_commit_work);
+    INIT_DELAYED_WORK(&priv->clock_work, lcd1602a_clock_work);
+    INIT_DELAYED_WORK(&priv->overlay.expire_work, lcd1602a_overlay_expire);
+    lcd1602a_set_max_fps(priv, max_fps);
+
+    spin_lock_init(&priv->bl.lock);
+    hrtimer_init(&priv->bl.pwm_timer, CLOCK_MONOTONIC, HRTIMER_MODE_REL);
+    priv->bl.pwm_timer.function = lcd1602a_pwm_timer;
+    INIT_WORK(&priv->bl.pwm_work, lcd1602a_pwm_work);
+    priv->bl.max_writes = LCD_BL_DEFAULT_MAX_WRITES;
 
     priv->btn = devm_gpiod_get(priv->dev, "button", GPIOD_IN);
     if (IS_ERR(priv->btn))
@@ -806,6 +3815,7 @@ static int lcd1602a_probe(struct i2c_client *client)
         if (ret) {
             dev_warn(priv->dev, "Warning! Could not set debounce! (code = %d)\n", ret);
             set_bit(LCD_NO_DEBOUNCE_FLAG, &priv->state_flags);
+            priv->button.debounce = ms_to_ktime(debounce_ms);
         }
     }
 
@@ -813,12 +3823,9 @@ static int lcd1602a_probe(struct i2c_client *client)
     if (priv->irq < 0)
         return priv->irq;
 
-    ret = devm_request_threaded_irq(priv->dev, priv->irq, NULL, lcd1602a_threaded_isr,
-                                    IRQF_ONESHOT | IRQF_TRIGGER_FALLING, LCD_MODULE_NAME, priv);
-    if (ret) {
-        dev_err(priv->dev, "Error! Could request IRQ handler! (code = %d)\n", ret);
+    ret = lcd1602a_button_init(priv);
+    if (ret)
         return ret;
-    }
 
     if (major) {
         devid = MKDEV(major, LCD_MINOR_BASE);
@@ -833,26 +3840,63 @@ static int lcd1602a_probe(struct i2c_client *client)
         return ret;
     }
 
-    priv->cdev.owner = THIS_MODULE;
-    cdev_init(&priv->cdev, &lcd1602a_fops);
-    ret = cdev_add(&priv->cdev, devid, LCD_MINOR_COUNT);
+    /* Open files may keep the cdev after priv is freed, so it isn't a part of it */
+    priv->cdev = cdev_alloc();
+    if (!priv->cdev) {
+        dev_err(priv->dev, "Error! Could not allocate cdev object!\n");
+        ret = -ENOMEM;
+        goto probe_err1;
+    }
+
+    priv->cdev->owner = THIS_MODULE;
+    priv->cdev->ops = &lcd1602a_fops;
+    ret = cdev_add(priv->cdev, devid, LCD_MINOR_COUNT);
     if (ret) {
         dev_err(priv->dev, "Error! Could register cdev object!\n");
+        kobject_put(&priv->cdev->kobj);
         goto probe_err1;
     }
 
-    device_create_file(priv->dev, &dev_attr_backlight);
+    ret = lcd1602a_backlight_register(priv);
+    if (ret)
+        goto probe_err2;
+
+    ret = sysfs_create_groups(&priv->dev->kobj, lcd1602a_attr_groups);
+    if (ret) {
+        dev_err(priv->dev, "Error! Could create sysfs attributes!\n");
+        goto probe_err3;
+    }
 
+    /* Backlight class device and sysfs are live, their users wait for the init sequence */
+    mutex_lock(&priv->bus_lock);
     ret = lcd1602a_init(priv);
+    mutex_unlock(&priv->bus_lock);
     if (ret)
-        goto probe_err2;
+        goto probe_err4;
+
+    lcd1602a_debugfs_init(priv);
+
+    if (charlcd) {
+        ret = lcd1602a_charlcd_register(priv);
+        if (ret)
+            dev_warn(priv->dev, "Warning! Could not register charlcd backend! (code = %d)\n", ret);
+        ret = 0;
+    }
+
+    mutex_lock(&lcd1602a_devices_lock);
+    list_add_tail(&priv->node, &lcd1602a_devices);
+    mutex_unlock(&lcd1602a_devices_lock);
 
     dev_info(priv->dev, "lcd1602a-i2c driver is probed! (major = %d)\n", major);
     return ret;
 
+probe_err4:
+    sysfs_remove_groups(&priv->dev->kobj, lcd1602a_attr_groups);
+probe_err3:
+    backlight_device_unregister(priv->bl.bd);
+    lcd1602a_pwm_stop(priv);
 probe_err2:
-    device_remove_file(priv->dev, &dev_attr_backlight);
-    cdev_del(&priv->cdev);
+    cdev_del(priv->cdev);
 probe_err1:
     unregister_chrdev_region(devid, LCD_MINOR_COUNT);
     return ret;
@@ -862,11 +3906,37 @@ static void lcd1602a_remove(struct i2c_client *client)
 {
     struct lcd1602a_data *priv = dev_get_drvdata(&client->dev);
 
+    mutex_lock(&lcd1602a_devices_lock);
+    list_del(&priv->node);
+    mutex_unlock(&lcd1602a_devices_lock);
+
+    /* In-kernel handles, open files and stores in flight get -ENODEV since now */
+    mutex_lock(&priv->bus_lock);
+    WRITE_ONCE(priv->removed, true);
+    mutex_unlock(&priv->bus_lock);
+
+    /* Everything which may queue the work items goes first: the interfaces,
+     * then the button. Its IRQ is freed by devm after remove(), the timers
+     * armed before disable_irq() are stopped here. */
+    lcd1602a_charlcd_unregister(priv);
+    debugfs_remove_recursive(priv->debugfs);
+    sysfs_remove_groups(&priv->dev->kobj, lcd1602a_attr_groups);
+    backlight_device_unregister(priv->bl.bd);
+
+    disable_irq(priv->irq);
+    lcd1602a_button_cleanup(&priv->button);
+
+    cancel_work_sync(&priv->update_work);
+    cancel_delayed_work_sync(&priv->overlay.expire_work);
+    cancel_delayed_work_sync(&priv->commit_work);
+    cancel_delayed_work_sync(&priv->clock_work);
+    lcd1602a_pwm_stop(priv);
+
+    mutex_lock(&priv->bus_lock);
     lcd1602a_exit(priv);
+    mutex_unlock(&priv->bus_lock);
 
-    device_remove_file(priv->dev, &dev_attr_backlight);
-
-    cdev_del(&priv->cdev);
+    cdev_del(priv->cdev);
     unregister_chrdev_region(MKDEV(major, LCD_MINOR_BASE), LCD_MINOR_COUNT);
 
     dev_info(priv->dev, "lcd1602a-i2c driver is removed!\n");
@@ -899,12 +3969,21 @@ static struct i2c_driver lcd1602a_driver = {
 
 static int __init lcd1602a_i2c_init(void)
 {
-    return i2c_add_driver(&lcd1602a_driver);
+    int ret;
+
+    lcd1602a_debugfs_root = debugfs_create_dir(LCD_MODULE_NAME, NULL);
+
+    ret = i2c_add_driver(&lcd1602a_driver);
+    if (ret)
+        debugfs_remove_recursive(lcd1602a_debugfs_root);
+
+    return ret;
 }
 
 static void __exit lcd1602a_i2c_exit(void)
 {
     i2c_del_driver(&lcd1602a_driver);
+    debugfs_remove_recursive(lcd1602a_debugfs_root);
 }
 
 module_init(lcd1602a_i2c_init);
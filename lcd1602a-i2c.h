@@ -0,0 +1,30 @@
+#ifndef LCD1602A_I2C_H
+#define LCD1602A_I2C_H
+
+/* In-kernel client API. A handle draws into its own buffer and competes for
+ * the screen with open files of /dev/lcd like any other client. Handles keep
+ * the driver's data alive, once the LCD is removed their calls fail with
+ * -ENODEV and the handle only has to be put. */
+
+#include <linux/types.h>
+
+struct device;
+struct device_node;
+struct lcd1602a_handle;
+
+/* @np is the LCD's I2C device node. Returns ERR_PTR(-EPROBE_DEFER) if the LCD
+ * hasn't been probed yet. */
+struct lcd1602a_handle *lcd1602a_get(struct device_node *np);
+/* LCD referenced by @propname phandle of the consumer's @dev node */
+struct lcd1602a_handle *lcd1602a_get_by_phandle(struct device *dev, const char *propname);
+void lcd1602a_put(struct lcd1602a_handle *handle);
+
+/* Text goes to the handle's buffer at @row/@col, '\n' moves to the next row */
+int lcd1602a_write_text(struct lcd1602a_handle *handle, unsigned int row, unsigned int col,
+                        const char *text, size_t len);
+/* Timed notification above all clients' content, 0 @timeout_ms removes it */
+int lcd1602a_show_overlay(struct lcd1602a_handle *handle, unsigned int row, unsigned int col,
+                          const char *text, size_t len, unsigned int timeout_ms);
+int lcd1602a_set_backlight(struct lcd1602a_handle *handle, bool on);
+
+#endif /* LCD1602A_I2C_H */
@@ -0,0 +1,57 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <string.h>
+
+#include "../lcd1602a-i2c-ioctls.h"
+
+/* Same batch can be submitted as IORING_OP_URING_CMD with cmd_op = LCD_IOC_BATCH */
+int main(void)
+{
+    int fd;
+    int ret = -1;
+    struct lcd_op ops[4];
+    struct lcd_batch batch;
+    static const unsigned char heart[LCD_CGRAM_ROWS] = {
+        0x00, 0x0a, 0x1f, 0x1f, 0x0e, 0x04, 0x00, 0x00
+    };
+
+    fd = open("/dev/lcd", O_RDWR);
+    if (fd < 0) {
+        perror("Error! Could not open /dev/lcd!");
+        return fd;
+    }
+
+    memset(ops, 0, sizeof(ops));
+
+    ops[0].type = LCD_OP_CGRAM;
+    ops[0].pos = 0;
+    memcpy(ops[0].data, heart, sizeof(heart));
+
+    ops[1].type = LCD_OP_TEXT;
+    ops[1].pos = 0;
+    ops[1].len = 7;
+    memcpy(ops[1].data, "batch \x00", 7);
+
+    ops[2].type = LCD_OP_TEXT;
+    ops[2].pos = 17;
+    ops[2].len = 8;
+    memcpy(ops[2].data, "2nd row ", 8);
+
+    ops[3].type = LCD_OP_CURSOR;
+    ops[3].value = 0;
+
+    batch.ops = (unsigned long long)(unsigned long)ops;
+    batch.nr_ops = 4;
+    batch.flags = 0;
+
+    ret = ioctl(fd, LCD_IOC_BATCH, &batch);
+    if (ret < 0)
+        perror("Error: BATCH failed!");
+    else
+        printf("%d ops executed\n", ret);
+
+    close(fd);
+    return ret;
+}
@@ -0,0 +1,47 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <string.h>
+
+#include "../lcd1602a-i2c-ioctls.h"
+
+/* Counts up showing 4 big digits, only changed digits are redrawn */
+int main(int argc, char **argv)
+{
+    int fd;
+    int ret = -1;
+    unsigned int count = (argc > 1) ? atoi(argv[1]) : 100;
+    struct lcd_widget counter = {
+        .id = 0,
+        .type = LCD_WIDGET_BIG_NUMBER,
+        .row = 0,
+        .col = 1,
+        .len = 4,
+    };
+
+    fd = open("/dev/lcd", O_RDWR | O_TRUNC);
+    if (fd < 0) {
+        perror("Error! Could not open /dev/lcd!");
+        return fd;
+    }
+
+    for (counter.value = 0; counter.value <= count; counter.value++) {
+        ret = ioctl(fd, LCD_IOC_WIDGET, &counter);
+        if (ret < 0) {
+            perror("Error: WIDGET failed!");
+            goto err;
+        }
+        usleep(200000);
+    }
+
+    /* Too big value is shown as dashes */
+    counter.value = 10000;
+    ret = ioctl(fd, LCD_IOC_WIDGET, &counter);
+    if (ret < 0)
+        perror("Error: WIDGET failed!");
+
+err:
+    close(fd);
+    return ret;
+}
@@ -0,0 +1,74 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <string.h>
+
+#include "../lcd1602a-i2c-ioctls.h"
+
+#define TICKS 5
+
+int main(void)
+{
+    int i, fd;
+    int ret = -1;
+    char prev[LCD_FRAME_COLS];
+    struct lcd_frame frame;
+    struct lcd_clock clock = {
+        .row = 1,
+        .col = 4,
+        .format = "%H:%M:%S",
+    };
+
+    fd = open("/dev/lcd", O_RDWR | O_TRUNC);
+    if (fd < 0) {
+        perror("Error! Could not open /dev/lcd!");
+        return fd;
+    }
+
+    if (write(fd, "Clock test", 10) < 0) {
+        perror("Error: write failed!");
+        goto err;
+    }
+
+    ret = ioctl(fd, LCD_IOC_CLOCK, &clock);
+    if (ret < 0) {
+        perror("Error: CLOCK failed!");
+        goto err;
+    }
+
+    memset(prev, 0, sizeof(prev));
+    for (i = 0; i < TICKS; i++) {
+        sleep(1);
+
+        ret = ioctl(fd, LCD_IOC_SCREENSHOT, &frame);
+        if (ret < 0) {
+            perror("Error: SCREENSHOT failed!");
+            goto err;
+        }
+
+        printf("|%.*s|\n", LCD_FRAME_COLS, frame.cells[1]);
+        if (frame.cells[1][6] != ':' || frame.cells[1][9] != ':') {
+            fprintf(stderr, "Error: clock isn't shown at its position!\n");
+            ret = -1;
+            goto err;
+        }
+
+        if (!memcmp(prev, frame.cells[1], LCD_FRAME_COLS)) {
+            fprintf(stderr, "Error: clock didn't tick!\n");
+            ret = -1;
+            goto err;
+        }
+        memcpy(prev, frame.cells[1], LCD_FRAME_COLS);
+    }
+
+    /* Empty format removes the clock */
+    clock.format[0] = '\0';
+    ret = ioctl(fd, LCD_IOC_CLOCK, &clock);
+    if (ret < 0)
+        perror("Error: CLOCK removal failed!");
+
+err:
+    close(fd);
+    return ret;
+}
@@ -0,0 +1,77 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <string.h>
+
+#include "../lcd1602a-i2c-ioctls.h"
+
+#define SET_REPEATS 10
+
+/* argv[1] is the statistics/cmds_skipped sysfs file of the LCD's I2C device */
+static int read_skipped(const char *path)
+{
+    int skipped = -1;
+    FILE *f = fopen(path, "r");
+    if (!f) {
+        perror("Error! Could not open cmds_skipped!");
+        return -1;
+    }
+
+    if (fscanf(f, "%d", &skipped) != 1)
+        skipped = -1;
+
+    fclose(f);
+    return skipped;
+}
+
+int main(int argc, char **argv)
+{
+    int i, fd, before, after;
+    int ret = -1;
+    unsigned int status = 0;
+
+    if (argc != 2) {
+        printf("Usage: %s /sys/bus/i2c/devices/<dev>/statistics/cmds_skipped\n", argv[0]);
+        return -1;
+    }
+
+    fd = open("/dev/lcd", O_RDWR | O_APPEND);
+    if (fd < 0) {
+        perror("Error! Could not open /dev/lcd!");
+        return fd;
+    }
+
+    ret = ioctl(fd, LCD_IOC_CURSOR_GET, &status);
+    if (ret < 0) {
+        perror("Error: CURSOR_GET failed!");
+        goto err;
+    }
+
+    before = read_skipped(argv[1]);
+    if (before < 0)
+        goto err;
+
+    /* Cursor is already in this state, none of these should reach the LCD */
+    for (i = 0; i < SET_REPEATS; i++) {
+        ret = ioctl(fd, LCD_IOC_CURSOR_SET, &status);
+        if (ret < 0) {
+            perror("Error: CURSOR_SET failed!");
+            goto err;
+        }
+    }
+
+    after = read_skipped(argv[1]);
+    if (after < 0)
+        goto err;
+
+    printf("cmds skipped: %d\n", after - before);
+    if (after - before < SET_REPEATS) {
+        fprintf(stderr, "Error: redundant cursor cmds were sent!\n");
+        ret = -1;
+    }
+
+err:
+    close(fd);
+    return ret;
+}
@@ -0,0 +1,68 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <string.h>
+
+#include "../lcd1602a-i2c-ioctls.h"
+
+int main(void)
+{
+    int fd, i;
+    int ret = -1;
+    struct lcd_frame frame;
+
+    fd = open("/dev/lcd", O_RDWR);
+    if (fd < 0) {
+        perror("Error! Could not open /dev/lcd!");
+        return fd;
+    }
+
+    /* Compose by write() and show both rows at once */
+    ret = ioctl(fd, LCD_IOC_FRAME_BEGIN);
+    if (ret < 0) {
+        perror("Error: FRAME_BEGIN failed!");
+        goto err;
+    }
+
+    if (write(fd, "first row\nsecond row", 20) < 0) {
+        perror("Error: write failed!");
+        goto err;
+    }
+
+    sleep(1);
+
+    ret = ioctl(fd, LCD_IOC_FRAME_COMMIT);
+    if (ret < 0) {
+        perror("Error: FRAME_COMMIT failed!");
+        goto err;
+    }
+
+    sleep(1);
+
+    /* Only the changing digit is sent on every commit */
+    for (i = 0; i < 10; i++) {
+        memset(&frame, ' ', sizeof(frame));
+        snprintf((char *)frame.cells[0], LCD_FRAME_COLS, "frame #%d", i);
+        frame.cells[0][strlen((char *)frame.cells[0])] = ' ';
+        memcpy(frame.cells[1], "double-buffered", 15);
+
+        ret = ioctl(fd, LCD_IOC_FRAME_SET, &frame);
+        if (ret < 0) {
+            perror("Error: FRAME_SET failed!");
+            goto err;
+        }
+
+        ret = ioctl(fd, LCD_IOC_FRAME_COMMIT);
+        if (ret < 0) {
+            perror("Error: FRAME_COMMIT failed!");
+            goto err;
+        }
+
+        usleep(500000);
+    }
+
+err:
+    close(fd);
+    return ret;
+}
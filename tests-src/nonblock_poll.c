@@ -0,0 +1,46 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <poll.h>
+
+int main(void)
+{
+    int fd, i;
+    int again = 0;
+    char buf[32];
+    struct pollfd pfd;
+
+    fd = open("/dev/lcd", O_WRONLY | O_NONBLOCK);
+    if (fd < 0) {
+        perror("Error! Could not open /dev/lcd!");
+        return fd;
+    }
+
+    pfd.fd = fd;
+    pfd.events = POLLOUT;
+
+    for (i = 0; i < 100; i++) {
+        snprintf(buf, sizeof(buf), "count = %-8d", i);
+        lseek(fd, 0, SEEK_SET);
+        if (write(fd, buf, 16) < 0) {
+            if (errno != EAGAIN) {
+                perror("Error! Write failed!");
+                break;
+            }
+
+            again++;
+            if (poll(&pfd, 1, 1000) <= 0) {
+                perror("Error! Poll failed!");
+                break;
+            }
+            i--;
+        }
+    }
+
+    printf("EAGAIN returned %d times\n", again);
+
+    close(fd);
+    return 0;
+}
@@ -0,0 +1,56 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <string.h>
+
+#include "../lcd1602a-i2c-ioctls.h"
+
+int main(void)
+{
+    int fd;
+    int ret = -1;
+    struct lcd_frame frame;
+    struct lcd_overlay overlay;
+
+    fd = open("/dev/lcd", O_RDWR | O_TRUNC);
+    if (fd < 0) {
+        perror("Error! Could not open /dev/lcd!");
+        return fd;
+    }
+
+    if (write(fd, "regular content\nstays untouched", 31) < 0) {
+        perror("Error: write failed!");
+        goto err;
+    }
+
+    /* Cover the 2nd row for 2 seconds */
+    memset(&overlay, 0, sizeof(overlay));
+    overlay.timeout_ms = 2000;
+    overlay.pos = LCD_FRAME_COLS + 1;
+    overlay.len = 12;
+    memcpy(overlay.data, "** ALERT! **", 12);
+
+    ret = ioctl(fd, LCD_IOC_OVERLAY, &overlay);
+    if (ret < 0) {
+        perror("Error: OVERLAY failed!");
+        goto err;
+    }
+
+    sleep(3);
+
+    ret = ioctl(fd, LCD_IOC_SCREENSHOT, &frame);
+    if (ret < 0) {
+        perror("Error: SCREENSHOT failed!");
+        goto err;
+    }
+
+    if (memcmp(frame.cells[1], "stays untouched", 15)) {
+        fprintf(stderr, "Error: content is not restored after the overlay!\n");
+        ret = -1;
+    }
+
+err:
+    close(fd);
+    return ret;
+}
@@ -0,0 +1,67 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <string.h>
+
+#include "../lcd1602a-i2c-ioctls.h"
+
+/* Driver should be loaded with page_flip=1, frames must change at once */
+#define FRAMES 20
+
+static const char *frames[2] = {
+    "AAAAAAAAAAAAAAAA\nBBBBBBBBBBBBBBBB",
+    "bbbbbbbbbbbbbbbb\naaaaaaaaaaaaaaaa",
+};
+
+int main(void)
+{
+    int i, fd;
+    int ret = -1;
+    const char *text;
+    struct lcd_frame frame;
+
+    fd = open("/dev/lcd", O_RDWR);
+    if (fd < 0) {
+        perror("Error! Could not open /dev/lcd!");
+        return fd;
+    }
+
+    for (i = 0; i < FRAMES; i++) {
+        text = frames[i % 2];
+
+        lseek(fd, 0, SEEK_SET);
+        if (write(fd, text, strlen(text)) < 0) {
+            perror("Error: write failed!");
+            goto err;
+        }
+
+        /* Blocking read waits for the frame to reach the screen */
+        lseek(fd, 0, SEEK_SET);
+        if (read(fd, &frame, 1) < 0) {
+            perror("Error: read failed!");
+            goto err;
+        }
+
+        ret = ioctl(fd, LCD_IOC_SCREENSHOT, &frame);
+        if (ret < 0) {
+            perror("Error: SCREENSHOT failed!");
+            goto err;
+        }
+
+        if (memcmp(frame.cells[0], text, LCD_FRAME_COLS) ||
+            memcmp(frame.cells[1], text + LCD_FRAME_COLS + 1, LCD_FRAME_COLS)) {
+            fprintf(stderr, "Error: frame %d doesn't match!\n", i);
+            ret = -1;
+            goto err;
+        }
+
+        usleep(200000);
+    }
+
+    printf("%d frames swapped\n", FRAMES);
+
+err:
+    close(fd);
+    return ret;
+}
@@ -0,0 +1,85 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <string.h>
+
+#include "../lcd1602a-i2c-ioctls.h"
+
+static int screen_starts_with(int fd, const char *text)
+{
+    char c;
+    struct lcd_frame frame;
+
+    /* Blocking read waits for the queued writes */
+    lseek(fd, 0, SEEK_SET);
+    if (read(fd, &c, 1) < 0 || ioctl(fd, LCD_IOC_SCREENSHOT, &frame) < 0)
+        return 0;
+
+    return !memcmp(frame.cells[0], text, strlen(text));
+}
+
+int main(void)
+{
+    int i, status_fd, alert_fd;
+    int ret = -1;
+    int prio = 10;
+    char buf[32];
+
+    status_fd = open("/dev/lcd", O_RDWR | O_TRUNC);
+    if (status_fd < 0) {
+        perror("Error! Could not open /dev/lcd!");
+        return status_fd;
+    }
+
+    alert_fd = open("/dev/lcd", O_RDWR);
+    if (alert_fd < 0) {
+        perror("Error! Could not open /dev/lcd second time!");
+        goto err;
+    }
+
+    if (ioctl(alert_fd, LCD_IOC_PRIORITY_SET, &prio) < 0) {
+        perror("Error: PRIORITY_SET failed!");
+        goto err;
+    }
+
+    lseek(alert_fd, 0, SEEK_SET);
+    if (write(alert_fd, "ALERT!          ", 16) < 0) {
+        perror("Error: alert write failed!");
+        goto err;
+    }
+
+    /* Status keeps updating under the alert */
+    for (i = 0; i < 5; i++) {
+        snprintf(buf, sizeof(buf), "status %-9d", i);
+        lseek(status_fd, 0, SEEK_SET);
+        if (write(status_fd, buf, 16) < 0) {
+            perror("Error: status write failed!");
+            goto err;
+        }
+
+        if (!screen_starts_with(status_fd, "ALERT!")) {
+            fprintf(stderr, "Error: status overwrote the alert!\n");
+            goto err;
+        }
+
+        usleep(200000);
+    }
+
+    /* The last status shows up when the alert goes away */
+    close(alert_fd);
+    alert_fd = -1;
+
+    if (!screen_starts_with(status_fd, "status 4")) {
+        fprintf(stderr, "Error: status is not restored!\n");
+        goto err;
+    }
+
+    ret = 0;
+
+err:
+    if (alert_fd >= 0)
+        close(alert_fd);
+    close(status_fd);
+    return ret;
+}
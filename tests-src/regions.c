@@ -0,0 +1,77 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <string.h>
+
+#include "../lcd1602a-i2c-ioctls.h"
+
+int main(void)
+{
+    int i, left_fd, right_fd;
+    int ret = -1;
+    char c, buf[16];
+    struct lcd_frame frame;
+    struct lcd_region left = { .row = 0, .col = 0, .rows = 2, .cols = 8 };
+    struct lcd_region right = { .row = 0, .col = 8, .rows = 2, .cols = 8 };
+
+    left_fd = open("/dev/lcd", O_RDWR | O_TRUNC);
+    if (left_fd < 0) {
+        perror("Error! Could not open /dev/lcd!");
+        return left_fd;
+    }
+
+    right_fd = open("/dev/lcd", O_RDWR);
+    if (right_fd < 0) {
+        perror("Error! Could not open /dev/lcd second time!");
+        goto err;
+    }
+
+    if (ioctl(left_fd, LCD_IOC_REGION_SET, &left) < 0 ||
+        ioctl(right_fd, LCD_IOC_REGION_SET, &right) < 0) {
+        perror("Error: REGION_SET failed!");
+        goto err;
+    }
+
+    /* Both halves are updated independently, rows are 8 chars wide */
+    for (i = 0; i < 10; i++) {
+        snprintf(buf, sizeof(buf), "L%-7d\nleft", i);
+        lseek(left_fd, 0, SEEK_SET);
+        if (write(left_fd, buf, strlen(buf)) < 0) {
+            perror("Error: left write failed!");
+            goto err;
+        }
+
+        snprintf(buf, sizeof(buf), "R%-7d\nright", i);
+        lseek(right_fd, 0, SEEK_SET);
+        if (write(right_fd, buf, strlen(buf)) < 0) {
+            perror("Error: right write failed!");
+            goto err;
+        }
+
+        usleep(300000);
+    }
+
+    /* Blocking read waits for the queued writes */
+    lseek(left_fd, 0, SEEK_SET);
+    if (read(left_fd, &c, 1) < 0 || ioctl(left_fd, LCD_IOC_SCREENSHOT, &frame) < 0) {
+        perror("Error: SCREENSHOT failed!");
+        goto err;
+    }
+
+    printf("|%.*s|\n|%.*s|\n", LCD_FRAME_COLS, frame.cells[0], LCD_FRAME_COLS, frame.cells[1]);
+
+    if (memcmp(frame.cells[0], "L9      R9      ", LCD_FRAME_COLS) ||
+        memcmp(frame.cells[1], "left    right   ", LCD_FRAME_COLS)) {
+        fprintf(stderr, "Error: regions are not merged!\n");
+        goto err;
+    }
+
+    ret = 0;
+
+err:
+    if (right_fd >= 0)
+        close(right_fd);
+    close(left_fd);
+    return ret;
+}
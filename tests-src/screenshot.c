@@ -0,0 +1,51 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <string.h>
+
+#include "../lcd1602a-i2c-ioctls.h"
+
+int main(void)
+{
+    int fd, row;
+    int ret = -1;
+    struct lcd_frame frame;
+
+    fd = open("/dev/lcd", O_RDWR | O_TRUNC);
+    if (fd < 0) {
+        perror("Error! Could not open /dev/lcd!");
+        return fd;
+    }
+
+    if (write(fd, "screenshot\ntest", 15) < 0) {
+        perror("Error: write failed!");
+        goto err;
+    }
+
+    /* Blocking read waits for the queued write to reach the screen */
+    lseek(fd, 0, SEEK_SET);
+    if (read(fd, &row, 1) < 0) {
+        perror("Error: read failed!");
+        goto err;
+    }
+
+    ret = ioctl(fd, LCD_IOC_SCREENSHOT, &frame);
+    if (ret < 0) {
+        perror("Error: SCREENSHOT failed!");
+        goto err;
+    }
+
+    for (row = 0; row < LCD_FRAME_ROWS; row++)
+        printf("|%.*s|\n", LCD_FRAME_COLS, frame.cells[row]);
+
+    if (memcmp(frame.cells[0], "screenshot      ", LCD_FRAME_COLS) ||
+        memcmp(frame.cells[1], "test", 4)) {
+        fprintf(stderr, "Error: screenshot doesn't match written text!\n");
+        ret = -1;
+    }
+
+err:
+    close(fd);
+    return ret;
+}
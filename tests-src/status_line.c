@@ -0,0 +1,105 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <string.h>
+
+#include "../lcd1602a-i2c-ioctls.h"
+
+#define PATH_SIZE 256
+
+static const char tmpl[] = "CPU {cpu:3}% T {temp:2}C\nload {load:5}";
+
+/* One small write per update, no /dev/lcd file is involved */
+static int sysfs_write(const char *dir, const char *attr, const char *text)
+{
+    int fd, ret;
+    char path[PATH_SIZE];
+
+    snprintf(path, sizeof(path), "%s/%s", dir, attr);
+    fd = open(path, O_WRONLY);
+    if (fd < 0) {
+        perror("Error! Could not open sysfs attribute!");
+        return fd;
+    }
+
+    ret = write(fd, text, strlen(text));
+    if (ret < 0)
+        fprintf(stderr, "Error: write of \"%s\" to %s failed!\n", text, attr);
+
+    close(fd);
+    return (ret < 0) ? ret : 0;
+}
+
+static int screenshot(struct lcd_frame *frame)
+{
+    int fd, ret;
+
+    fd = open("/dev/lcd", O_RDONLY);
+    if (fd < 0) {
+        perror("Error! Could not open /dev/lcd!");
+        return fd;
+    }
+
+    ret = ioctl(fd, LCD_IOC_SCREENSHOT, frame);
+    if (ret < 0)
+        perror("Error: SCREENSHOT failed!");
+
+    close(fd);
+    return ret;
+}
+
+int main(int argc, char **argv)
+{
+    int i, ret;
+    char value[32];
+    struct lcd_frame frame;
+
+    if (argc != 2) {
+        printf("Usage: %s /sys/bus/i2c/devices/<dev>\n", argv[0]);
+        return -1;
+    }
+
+    ret = sysfs_write(argv[1], "template", tmpl);
+    if (ret)
+        return ret;
+
+    for (i = 0; i <= 100; i += 25) {
+        snprintf(value, sizeof(value), "cpu=%d", i);
+        ret = sysfs_write(argv[1], "field", value);
+        if (ret)
+            return ret;
+
+        snprintf(value, sizeof(value), "temp=%d", 40 + i / 10);
+        ret = sysfs_write(argv[1], "field", value);
+        if (ret)
+            return ret;
+
+        usleep(500000);
+    }
+
+    ret = sysfs_write(argv[1], "field", "load=0.42");
+    if (ret)
+        return ret;
+
+    /* Value longer than its field must be refused */
+    if (!sysfs_write(argv[1], "field", "cpu=1000")) {
+        fprintf(stderr, "Error: too long value was accepted!\n");
+        return -1;
+    }
+
+    usleep(100000);
+    ret = screenshot(&frame);
+    if (ret)
+        return ret;
+
+    printf("|%.*s|\n|%.*s|\n", LCD_FRAME_COLS, frame.cells[0], LCD_FRAME_COLS, frame.cells[1]);
+    if (memcmp(frame.cells[0], "CPU 100% T 50C  ", LCD_FRAME_COLS) ||
+        memcmp(frame.cells[1], "load  0.42      ", LCD_FRAME_COLS)) {
+        fprintf(stderr, "Error: status line doesn't match the fields!\n");
+        return -1;
+    }
+
+    /* Empty template removes the status line */
+    return sysfs_write(argv[1], "template", "\n");
+}
@@ -0,0 +1,73 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <string.h>
+
+#include "../lcd1602a-i2c-ioctls.h"
+
+/* Driver must be loaded with viewport=1 */
+#define DDRAM_COLS 40
+
+static const char text[] =
+    "Scrolling over the whole DDRAM row ---->\n"
+    "is one display shift cmd per column --->";
+
+int main(void)
+{
+    int fd;
+    int ret = -1;
+    unsigned int offset;
+    struct lcd_frame frame;
+
+    fd = open("/dev/lcd", O_RDWR | O_TRUNC);
+    if (fd < 0) {
+        perror("Error! Could not open /dev/lcd!");
+        return fd;
+    }
+
+    if (write(fd, text, sizeof(text) - 1) < 0) {
+        perror("Error: write failed!");
+        goto err;
+    }
+
+    for (offset = 0; offset <= DDRAM_COLS - LCD_FRAME_COLS; offset++) {
+        ret = ioctl(fd, LCD_IOC_VIEWPORT_SET, &offset);
+        if (ret < 0) {
+            perror("Error: VIEWPORT_SET failed!");
+            goto err;
+        }
+        usleep(250000);
+    }
+
+    offset = 0;
+    ret = ioctl(fd, LCD_IOC_VIEWPORT_GET, &offset);
+    if (ret < 0) {
+        perror("Error: VIEWPORT_GET failed!");
+        goto err;
+    }
+
+    ret = ioctl(fd, LCD_IOC_SCREENSHOT, &frame);
+    if (ret < 0) {
+        perror("Error: SCREENSHOT failed!");
+        goto err;
+    }
+
+    printf("offset = %u\n|%.*s|\n", offset, LCD_FRAME_COLS, frame.cells[0]);
+    if (offset != DDRAM_COLS - LCD_FRAME_COLS ||
+        memcmp(frame.cells[0], &text[offset], LCD_FRAME_COLS)) {
+        fprintf(stderr, "Error: visible window doesn't match the offset!\n");
+        ret = -1;
+    }
+
+    /* Back to the start */
+    offset = 0;
+    if (ioctl(fd, LCD_IOC_VIEWPORT_SET, &offset) < 0) {
+        perror("Error: VIEWPORT_SET failed!");
+        ret = -1;
+    }
+
+err:
+    close(fd);
+    return ret;
+}
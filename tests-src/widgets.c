@@ -0,0 +1,78 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <string.h>
+
+#include "../lcd1602a-i2c-ioctls.h"
+
+#define STEPS 50
+
+int main(void)
+{
+    int i, fd;
+    int ret = -1;
+    struct lcd_widget progress = {
+        .id = 0,
+        .type = LCD_WIDGET_PROGRESS,
+        .row = 0,
+        .col = 0,
+        .len = 12,
+        .max = STEPS,
+    };
+    struct lcd_widget hbar = {
+        .id = 1,
+        .type = LCD_WIDGET_HBAR,
+        .row = 1,
+        .col = 0,
+        .len = 14,
+        .max = STEPS,
+    };
+    struct lcd_widget vbar = {
+        .id = 2,
+        .type = LCD_WIDGET_VBAR,
+        .row = 0,
+        .col = 15,
+        .len = 2,
+        .max = STEPS,
+    };
+    struct lcd_frame frame;
+
+    fd = open("/dev/lcd", O_RDWR | O_TRUNC);
+    if (fd < 0) {
+        perror("Error! Could not open /dev/lcd!");
+        return fd;
+    }
+
+    for (i = 0; i <= STEPS; i++) {
+        progress.value = i;
+        hbar.value = STEPS - i;
+        vbar.value = i;
+
+        if (ioctl(fd, LCD_IOC_WIDGET, &progress) < 0 ||
+            ioctl(fd, LCD_IOC_WIDGET, &hbar) < 0 ||
+            ioctl(fd, LCD_IOC_WIDGET, &vbar) < 0) {
+            perror("Error: WIDGET failed!");
+            goto err;
+        }
+        usleep(100000);
+    }
+
+    /* Full progress, empty bar below it */
+    if (ioctl(fd, LCD_IOC_SCREENSHOT, &frame) < 0) {
+        perror("Error: SCREENSHOT failed!");
+        goto err;
+    }
+
+    if (memcmp(&frame.cells[0][12], "100%", 4) || frame.cells[0][0] != 0xff ||
+        frame.cells[1][0] != ' ') {
+        fprintf(stderr, "Error: widgets don't show the last values!\n");
+        goto err;
+    }
+
+    ret = 0;
+
+err:
+    close(fd);
+    return ret;
+}